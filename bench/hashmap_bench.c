@@ -0,0 +1,80 @@
+// Micro benchmark of the HashMap.
+//
+// Usage: hashmap_bench
+// Many keys are inserted, looked up and deleted, and the time of each is reported
+// with the memory of the buckets and control bytes.
+
+#include "util/util.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Number of keys in the benchmark
+#define BENCH_KEYS (1 << 20)
+
+static char *genkey(int i) {
+  char *str = calloc(30, sizeof(char));
+  sprintf(str, "key %d", i);
+  return str;
+}
+
+static double now_sec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long map_bytes(HashMap *map) {
+  return (long)map->capacity * (sizeof(HashBucket) + sizeof(*map->ctrl));
+}
+
+// Most maps are small, since every scope has its own maps.
+static void bench_small() {
+  HashMap map = {};
+  hashmap_insert(&map, "key", "item");
+  printf("hashmap with 1 key: %d buckets, %ld bytes\n", map.capacity, map_bytes(&map));
+}
+
+static void bench_large() {
+  char **keys = calloc(BENCH_KEYS, sizeof(char *));
+  for (int i = 0; i < BENCH_KEYS; i++) {
+    keys[i] = genkey(i);
+  }
+
+  HashMap map = {};
+  double begin = now_sec();
+  for (int i = 0; i < BENCH_KEYS; i++) {
+    hashmap_insert(&map, keys[i], keys[i]);
+  }
+  double insert_sec = now_sec() - begin;
+  int capacity = map.capacity;
+  long bytes = map_bytes(&map);
+
+  begin = now_sec();
+  for (int i = 0; i < BENCH_KEYS; i++) {
+    assert(hashmap_get(&map, keys[i]) == keys[i]);
+  }
+  double get_sec = now_sec() - begin;
+
+  begin = now_sec();
+  for (int i = 0; i < BENCH_KEYS; i += 2) {
+    hashmap_delete(&map, keys[i]);
+  }
+  for (int i = 0; i < BENCH_KEYS; i++) {
+    assert(hashmap_get(&map, keys[i]) == (i % 2 ? keys[i] : NULL));
+  }
+  double delete_sec = now_sec() - begin;
+
+  printf("hashmap with %d keys: insert %.3f sec, get %.3f sec, delete and get %.3f sec\n",
+         BENCH_KEYS, insert_sec, get_sec, delete_sec);
+  printf("hashmap with %d keys: %d buckets, %ld bytes (%.1f bytes per key)\n",
+         BENCH_KEYS, capacity, bytes, (double)bytes / BENCH_KEYS);
+}
+
+int main() {
+  bench_small();
+  bench_large();
+  return 0;
+}
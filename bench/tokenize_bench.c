@@ -0,0 +1,79 @@
+// Micro benchmark of the lexer.
+//
+// Usage: tokenize_bench [file...]
+// Each given file is tokenized and the throughput is reported in MB/s.
+// Without arguments, a large C source is generated and tokenized instead.
+
+#include "parser/parser.h"
+#include "token/tokenize.h"
+#include "util/util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Size of the generated source
+#define GEN_SIZE (8 << 20)
+
+static char *gen_source(size_t size) {
+  static char *lines[] = {
+    "// Generated source for the lexer benchmark\n",
+    "static unsigned long table_%d[4] = {0x10, 020, 30UL, 40};\n",
+    "struct node_%d { int value; struct node_%d *next; };\n",
+    "int func_%d(int a, int b) {\n",
+    "  if (a <= b && b != 0) {\n",
+    "    a <<= 2; b >>= 1; a += b * 3 - (a %% 7);\n",
+    "  }\n",
+    "  /* block comment\n     over two lines */\n",
+    "  for (int i = 0; i < 16; i++) { a ^= i | b; }\n",
+    "  char *str = \"string literal %d\\n\"; char c = 'x';\n",
+    "  return a > b ? a : b;\n",
+    "}\n",
+  };
+  int nlines = sizeof(lines) / sizeof(*lines);
+
+  char *buf = calloc(size + 256, sizeof(char));
+  size_t len = 0;
+  for (int i = 0; len < size; i++) {
+    char *fmt = lines[i % nlines];
+    len += sprintf(buf + len, fmt, i, i);
+  }
+  return buf;
+}
+
+static double now_sec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(File *file) {
+  size_t len = strlen(file->contents);
+
+  double begin = now_sec();
+  Token *tkn = tokenize_file(file);
+  double sec = now_sec() - begin;
+
+  long cnt = 0;
+  for (; tkn != NULL; tkn = tkn->next) {
+    cnt++;
+  }
+
+  printf("%s: %.2f MB, %ld tokens, %.3f sec, %.2f MB/s\n",
+      file->name, len / 1e6, cnt, sec, len / 1e6 / sec);
+}
+
+int main(int argc, char **argv) {
+  init_type();
+
+  if (argc == 1) {
+    bench(new_file("generated", gen_source(GEN_SIZE)));
+    return 0;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    bench(read_file(argv[i]));
+  }
+  return 0;
+}
@@ -2,8 +2,10 @@
 #include "parser/parser.h"
 #include "token/tokenize.h"
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static void add_default_include_paths() {
   add_include_path("/usr/include/x86_64-linux-gnu");
@@ -11,17 +13,149 @@ static void add_default_include_paths() {
   add_include_path("/usr/local/include");
 }
 
+static void usage() {
+  fprintf(stderr, "Invalid arguments.\n");
+  fprintf(stderr, "Usage: jcc [--stats] [-include-pch <pch_file>] <input_file> <output_file>\n");
+  fprintf(stderr, "       jcc -E [-P] [-include-pch <pch_file>] <input_file> [<output_file>]\n");
+  fprintf(stderr, "       jcc -M|-MM [-MF <dep_file>] [-MT <target>] <input_file> [<dep_file>]\n");
+  fprintf(stderr, "       jcc -MD|-MMD [-MF <dep_file>] [-MT <target>] <input_file> <output_file>\n");
+  fprintf(stderr, "       jcc --emit-pch <header_file> <pch_file>\n");
+  exit(1);
+}
+
+// Return the path whose extension is replaced with ext.
+static char *replace_ext(char *path, char *ext) {
+  char *base = strrchr(path, '/');
+  base = base != NULL ? base + 1 : path;
+
+  char *dot = strrchr(base, '.');
+  int len = dot != NULL ? (int)(dot - path) : (int)strlen(path);
+  char *str = calloc(len + strlen(ext) + 1, sizeof(char));
+  sprintf(str, "%.*s%s", len, path, ext);
+  return str;
+}
+
+// As gcc, "-M" writes the rule of the object file of the input to stdout,
+// and "-MD" writes the rule of the output file next to it as ".d" file.
+// If "-MD" has no output file as "-E" to stdout, the names come from the input
+// in the current directory.
+static void set_dep_output(char *input_file, char *output_file, bool is_dep_only, char **dep_file, char **dep_target) {
+  char *base = strrchr(input_file, '/');
+  base = base != NULL ? base + 1 : input_file;
+
+  if (is_dep_only) {
+    if (*dep_file == NULL) {
+      *dep_file = output_file;
+    }
+    if (*dep_target == NULL) {
+      *dep_target = replace_ext(base, ".o");
+    }
+    return;
+  }
+
+  if (output_file == NULL) {
+    if (*dep_file == NULL) {
+      *dep_file = replace_ext(base, ".d");
+    }
+    if (*dep_target == NULL) {
+      *dep_target = replace_ext(base, ".o");
+    }
+    return;
+  }
+
+  if (*dep_file == NULL) {
+    *dep_file = replace_ext(output_file, ".d");
+  }
+  if (*dep_target == NULL) {
+    *dep_target = output_file;
+  }
+}
+
 int main(int argc, char **argv) {
-  if (argc != 3) {
-    fprintf(stderr, "Invalid arguments.\n");
-    fprintf(stderr, "Usage: jcc <input_file> <output_file>\n");
-    exit(1);
+  char *input_file = NULL, *output_file = NULL;
+  char *pch_file = NULL;
+  bool print_stats = false;
+  bool is_emit_pch = false;
+  bool is_preprocess_only = false;
+  bool has_linemarker = true;
+
+  // Options of the dependency output
+  bool is_dep_only = false, is_dep = false, has_system_dep = true;
+  char *dep_file = NULL, *dep_target = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stats") == 0) {
+      print_stats = true;
+    } else if (strcmp(argv[i], "-E") == 0) {
+      is_preprocess_only = true;
+    } else if (strcmp(argv[i], "-P") == 0) {
+      has_linemarker = false;
+    } else if (strcmp(argv[i], "-M") == 0 || strcmp(argv[i], "-MM") == 0) {
+      is_dep_only = is_dep = true;
+      has_system_dep = strcmp(argv[i], "-M") == 0;
+    } else if (strcmp(argv[i], "-MD") == 0 || strcmp(argv[i], "-MMD") == 0) {
+      is_dep = true;
+      has_system_dep = strcmp(argv[i], "-MD") == 0;
+    } else if (strcmp(argv[i], "-MF") == 0) {
+      if (++i == argc) {
+        usage();
+      }
+      dep_file = argv[i];
+    } else if (strcmp(argv[i], "-MT") == 0) {
+      if (++i == argc) {
+        usage();
+      }
+      dep_target = argv[i];
+    } else if (strcmp(argv[i], "--emit-pch") == 0) {
+      is_emit_pch = true;
+    } else if (strcmp(argv[i], "-include-pch") == 0) {
+      if (++i == argc) {
+        usage();
+      }
+      pch_file = argv[i];
+    } else if (input_file == NULL) {
+      input_file = argv[i];
+    } else if (output_file == NULL) {
+      output_file = argv[i];
+    } else {
+      usage();
+    }
+  }
+
+  // The preprocessed output is written to stdout if the output file is omitted.
+  if (input_file == NULL || (output_file == NULL && !is_preprocess_only && !is_dep_only)) {
+    usage();
+  }
+
+  if (is_dep) {
+    set_dep_output(input_file, output_file, is_dep_only, &dep_file, &dep_target);
   }
 
   add_default_include_paths();
   init_type();
 
-  Token *tkn = tokenize(argv[1]);
-  Node *head = program(tkn);
-  codegen(head, argv[2]);
+  if (is_emit_pch) {
+    emit_pch(input_file, output_file);
+  } else if (is_dep_only) {
+    // All includes are resolved by preprocessing to the end.
+    for (Token *tkn = tokenize(input_file, pch_file); !is_eof(tkn); tkn = next_token(tkn));
+  } else if (is_preprocess_only) {
+    Token *tkn = tokenize(input_file, pch_file);
+    output_preprocessed(tkn, output_file, has_linemarker);
+  } else {
+    Token *tkn = tokenize(input_file, pch_file);
+    Node *head = program(tkn);
+    codegen(head, output_file);
+  }
+
+  if (is_dep) {
+    output_dependencies(dep_file, dep_target, input_file, has_system_dep);
+  }
+
+  if (print_stats) {
+    print_token_stats();
+    print_ast_stats();
+    print_type_stats();
+    print_arena_stats();
+  }
 }
@@ -25,7 +25,7 @@ Type *ty_f64;
 Type *ty_f80;
 
 static Type *new_type(TypeKind kind, bool is_unsigned, int size) {
-  Type *ty = calloc(1, sizeof(Type));
+  Type *ty = arena_calloc(&type_arena, 1, sizeof(Type));
   ty->kind = kind;
   ty->is_unsigned = is_unsigned;
   ty->var_size = size;
@@ -34,7 +34,7 @@ static Type *new_type(TypeKind kind, bool is_unsigned, int size) {
 }
 
 Type *copy_type(Type *ty) {
-  Type *cty = calloc(1, sizeof(Type));
+  Type *cty = arena_calloc(&type_arena, 1, sizeof(Type));
   memcpy(cty, ty, sizeof(Type));
   return cty;
 }
@@ -73,18 +73,107 @@ Type *extract_arr_type(Type *ty) {
   return ty;
 }
 
-Type *pointer_to(Type *base) {
-  Type *ty = new_type(TY_PTR, false, 8);
+// The pointer and array types are interned, so that the equal types share
+// one canonical Type. A canonical Type must not be modified, so copy it
+// with copy_type() before setting a name or another member.
+typedef struct {
+  Type *base;
+  int64_t array_len;
+  int32_t kind;
+  int32_t is_const;
+} TypeKey;
+
+// The key is allocated with the canonical type.
+typedef struct {
+  Type ty;
+  TypeKey key;
+} InternedType;
+
+static HashMap type_table;
+
+// Number of the lookups of the derived types, printed by "--stats" option
+static int64_t type_hits = 0;
+static int64_t type_misses = 0;
+
+void print_type_stats() {
+  fprintf(stderr, "interned types: %ld (%ld lookups hit)\n", type_misses, type_hits);
+}
+
+static Type *derived_type(TypeKind kind, Type *base, int array_len, bool is_const) {
+  TypeKey key = {base, array_len, kind, is_const};
+  Type *ty = hashmap_nget(&type_table, (char *)&key, sizeof(TypeKey));
+  if (ty != NULL) {
+    type_hits++;
+    return ty;
+  }
+  type_misses++;
+
+  InternedType *interned = arena_calloc(&type_arena, 1, sizeof(InternedType));
+  interned->key = key;
+
+  ty = &interned->ty;
+  ty->kind = kind;
   ty->base = base;
+  ty->is_const = is_const;
+  if (kind == TY_PTR) {
+    ty->var_size = ty->align = 8;
+  } else {
+    ty->var_size = array_len * base->var_size;
+    ty->array_len = array_len;
+    ty->align = base->align;
+  }
+
+  hashmap_ninsert(&type_table, (char *)&interned->key, sizeof(TypeKey), ty);
   return ty;
 }
 
+Type *pointer_to(Type *base) {
+  return derived_type(TY_PTR, base, 0, false);
+}
+
 Type *array_to(Type *base, int array_len) {
-  Type *ty = new_type(TY_ARRAY, false, array_len * base->var_size);
-  ty->base = base;
-  ty->array_len = array_len;
-  ty->align = base->align;
-  return ty;
+  return derived_type(TY_ARRAY, base, array_len, false);
+}
+
+// Return the type qualified by const or not.
+// The type is not modified. The pointer and array types return the other
+// canonical type, and the other types return a copy. The const qualified
+// copy is made once and shared.
+Type *qualify_type(Type *ty, bool is_const) {
+  if (ty->is_const == is_const) {
+    return ty;
+  }
+
+  if (ty->kind == TY_PTR || ty->kind == TY_ARRAY) {
+    return derived_type(ty->kind, ty->base, ty->array_len, is_const);
+  }
+
+  if (!is_const) {
+    Type *cty = copy_type(ty);
+    cty->is_const = false;
+    cty->qualified = ty;
+    return cty;
+  }
+
+  if (ty->qualified == NULL) {
+    ty->qualified = copy_type(ty);
+    ty->qualified->is_const = true;
+    ty->qualified->qualified = NULL;
+  }
+  return ty->qualified;
+}
+
+// The const qualified copy of an incomplete struct or union
+// is updated when the type is completed.
+void complete_qualified_type(Type *ty) {
+  Type *qty = ty->qualified;
+  if (qty == NULL) {
+    return;
+  }
+
+  *qty = *ty;
+  qty->is_const = true;
+  qty->qualified = NULL;
 }
 
 bool is_integer_type(Type *ty) {
@@ -137,6 +226,11 @@ bool is_ptr_type(Type *ty) {
 
 bool is_same_type(Type *lty, Type *rty) {
   while (lty != NULL && rty != NULL) {
+    // The canonical types are the same object.
+    if (lty == rty) {
+      return true;
+    }
+
     if (lty->kind != rty->kind) {
       return false;
     }
@@ -159,50 +253,114 @@ bool is_same_type(Type *lty, Type *rty) {
   return true;
 }
 
+// The name is not copied, so that an interned name is inserted into
+// the scope without being compared by string.
 Obj *new_obj(Type *type, char *name) {
-  int name_len = strlen(name);
-  Obj *ret = calloc(1, sizeof(Obj));
+  Obj *ret = arena_calloc(&ast_arena, 1, sizeof(Obj));
   ret->ty = type;
-  ret->name = calloc(name_len + 1, sizeof(char));
-  memcpy(ret->name, name, name_len);
-  ret->name_len = name_len;
+  ret->name = name;
+  ret->name_len = strlen(name);
   return ret;
 }
 
-typedef struct Scope Scope;
-struct Scope {
-  Scope *up;
-
-  HashMap var;
-  HashMap tag;
-  HashMap type_def;
+// All scopes share one table for each namespace.
+// The symbols of the same name are stacked from the innermost scope,
+// so a lookup is one probe regardless of the depth of the scope.
+typedef struct Symbol Symbol;
+struct Symbol {
+  Atom *name;
+  void *item;
+  int depth;        // Depth of the scope which declares the symbol
+  Symbol *shadow;   // Symbol of the same name in the outer scope
+  HashMap *table;   // Table which has the symbol
+  Symbol *undo;     // Previous symbol in the undo log
 };
 
-static Scope *scope = &(Scope){};
+static HashMap var_table;
+static HashMap tag_table;
+static HashMap type_def_table;
+
+// The symbols declared in the local scopes are recorded,
+// and they are popped when the scope is left.
+static Symbol *undo_log;
+static int scope_depth;
 
 // The reason for allocating 8 bytes at the beginning is to keep
 // track of how much space is allocated as a variable.
 static int offset = 8;
 
 void enter_scope() {
-  Scope *sc = calloc(1, sizeof(Scope));
-  sc->up = scope;
-  scope = sc;
+  scope_depth++;
 }
 
 void leave_scope() {
-  if (scope == NULL) {
+  if (scope_depth == 0) {
     errorf(ER_INTERNAL, "Internal error at scope");
   }
 
-  scope = scope->up;
+  for (; undo_log != NULL && undo_log->depth == scope_depth; undo_log = undo_log->undo) {
+    Symbol *sym = undo_log;
+    if (sym->shadow != NULL) {
+      hashmap_ainsert(sym->table, sym->name, sym->shadow);
+    } else {
+      hashmap_adelete(sym->table, sym->name);
+    }
+  }
+  scope_depth--;
+}
+
+static void *find_symbol(HashMap *table, Atom *name) {
+  Symbol *sym = hashmap_aget(table, name);
+  return sym != NULL ? sym->item : NULL;
+}
+
+// Return the item if the name is declared in the current scope.
+static void *find_local_symbol(HashMap *table, Atom *name) {
+  Symbol *sym = hashmap_aget(table, name);
+  return sym != NULL && sym->depth == scope_depth ? sym->item : NULL;
+}
+
+// Set the item of the name in the scope of the depth,
+// which is the current scope or the global scope.
+static void set_symbol(HashMap *table, Atom *name, void *item, int depth) {
+  Symbol *prev = NULL;
+  Symbol *cur = hashmap_aget(table, name);
+  while (cur != NULL && cur->depth > depth) {
+    prev = cur;
+    cur = cur->shadow;
+  }
+
+  if (cur != NULL && cur->depth == depth) {
+    cur->item = item;
+    return;
+  }
+
+  Symbol *sym = arena_calloc(&ast_arena, 1, sizeof(Symbol));
+  sym->name = name;
+  sym->item = item;
+  sym->depth = depth;
+  sym->shadow = cur;
+  sym->table = table;
+
+  if (prev != NULL) {
+    prev->shadow = sym;
+  } else {
+    hashmap_ainsert(table, name, sym);
+  }
+
+  // The global symbols are never popped.
+  if (depth != 0) {
+    sym->undo = undo_log;
+    undo_log = sym;
+  }
 }
 
 void add_var(Obj *var, bool set_offset) {
-  if (hashmap_get(&(scope->var), var->name) != NULL) {
+  Atom *name = intern_atom(var->name, var->name_len);
+  if (find_local_symbol(&var_table, name) != NULL) {
     errorf(ER_COMPILE, "Variable '%s' is already declare", var->name);
   }
-  hashmap_insert(&(scope->var), var->name, var);
+  set_symbol(&var_table, name, var, scope_depth);
 
   if (set_offset) {
     int sz = var->ty->var_size;
@@ -211,60 +369,42 @@ void add_var(Obj *var, bool set_offset) {
   }
 }
 
-void add_tag(Type *ty, char *name) {
-  if (hashmap_get(&(scope->tag), name) != NULL) {
+void add_tag(Type *ty, Atom *name) {
+  if (find_local_symbol(&tag_table, name) != NULL) {
     errorf_tkn(ER_COMPILE, ty->tkn, "This tag is already declare");
   }
-  hashmap_insert(&(scope->tag), name, ty);
+  set_symbol(&tag_table, name, ty, scope_depth);
 }
 
-void enforce_add_tag(Type *ty, char *name) {
-  Type *already = hashmap_get(&(scope->tag), name);
+void enforce_add_tag(Type *ty, Atom *name) {
+  Type *already = find_local_symbol(&tag_table, name);
 
+  // The const qualified copy is kept to be completed with the type.
   if (already != NULL) {
-    memcpy(already, ty, sizeof(Obj));
+    Type *qualified = already->qualified;
+    memcpy(already, ty, sizeof(Type));
+    already->qualified = qualified;
   } else {
     add_tag(ty, name);
   }
 }
-void add_type_def(Type *ty, char *name) {
-  if (hashmap_get(&(scope->type_def), name) != NULL) {
-    errorf_tkn(ER_COMPILE, ty->tkn, "Name '%s' is already define", name);
+void add_type_def(Type *ty, Atom *name) {
+  if (find_local_symbol(&type_def_table, name) != NULL) {
+    errorf_tkn(ER_COMPILE, ty->tkn, "Name '%s' is already define", name->name);
   }
-  hashmap_insert(&(scope->type_def), name, ty);
+  set_symbol(&type_def_table, name, ty, scope_depth);
 }
 
-Obj *find_var(char *name) {
-  for (Scope *cur = scope; cur != NULL; cur = cur->up) {
-    Obj *obj = hashmap_get(&(cur->var), name);
-    if (obj != NULL) {
-      return obj;
-    }
-  }
-
-  return NULL;
+Obj *find_var(Atom *name) {
+  return find_symbol(&var_table, name);
 }
 
-Type *find_tag(char *name) {
-  for (Scope *cur = scope; cur != NULL; cur = cur->up) {
-    Type *ty = hashmap_get(&(cur->tag), name);
-    if (ty != NULL) {
-      return ty;
-    }
-  }
-
-  return NULL;
+Type *find_tag(Atom *name) {
+  return find_symbol(&tag_table, name);
 }
 
-Type *find_type_def(char *name) {
-  for (Scope *cur = scope; cur != NULL; cur = cur->up) {
-    Type *ty = hashmap_get(&(cur->type_def), name);
-    if (ty != NULL) {
-      return ty;
-    }
-  }
-
-  return NULL;
+Type *find_type_def(Atom *name) {
+  return find_symbol(&type_def_table, name);
 }
 
 static bool check_func_params(Type *lty, Type *rty) {
@@ -287,7 +427,7 @@ static bool check_func_params(Type *lty, Type *rty) {
 
 bool declare_func(Type *ty, bool is_static) {
   ty->is_prototype = true;
-  Obj *already = find_var(ty->name);
+  Obj *already = find_var(intern_atom(ty->name, strlen(ty->name)));
 
   if (already == NULL) {
     Obj *obj = new_obj(ty, ty->name);
@@ -319,7 +459,7 @@ bool declare_func(Type *ty, bool is_static) {
   if (already->params == NULL) {
     Obj *obj = new_obj(ty, ty->name);
     obj->is_static = already->is_static | is_static;
-    hashmap_insert(&(scope->var), ty->name, obj);
+    set_symbol(&var_table, intern_atom(ty->name, strlen(ty->name)), obj, scope_depth);
 
     if (obj->is_static) {
       obj->name = new_unique_label();
@@ -333,7 +473,7 @@ bool declare_func(Type *ty, bool is_static) {
 
 bool define_func(Type *ty, bool is_static) {
   ty->is_prototype = false;
-  Obj *alrady = find_var(ty->name);
+  Obj *alrady = find_var(intern_atom(ty->name, strlen(ty->name)));
 
   if (alrady != NULL && (!alrady->ty->is_prototype || !check_func_params(ty, alrady->ty))) {
     return false;
@@ -347,11 +487,7 @@ bool define_func(Type *ty, bool is_static) {
     obj->is_static = alrady->is_static | is_static;
   }
 
-  Scope *gscope = scope;
-  while (gscope->up != NULL) {
-    gscope = gscope->up;
-  }
-  hashmap_insert(&(gscope->var), ty->name, obj);
+  set_symbol(&var_table, intern_atom(ty->name, strlen(ty->name)), obj, 0);
 
   if (obj->is_static) {
     obj->name = new_unique_label();
@@ -391,13 +527,39 @@ void add_type(Node *node) {
 
   add_type(node->lhs);
   add_type(node->rhs);
-  add_type(node->cond);
-  add_type(node->then);
-  add_type(node->other);
-  add_type(node->init);
-  add_type(node->loop);
+
+  // The children in the payload depend on the kind
+  switch (node->kind) {
+    case ND_IF:
+      add_type(node->cond);
+      add_type(node->then);
+      add_type(node->other);
+      break;
+    case ND_FOR:
+    case ND_DO:
+      add_type(node->cond);
+      add_type(node->then);
+      add_type(node->init);
+      add_type(node->loop);
+      break;
+    case ND_SWITCH:
+    case ND_COND:
+      add_type(node->cond);
+      break;
+    case ND_INIT:
+      add_type(node->init);
+      break;
+    case ND_FUNC:
+    case ND_BLOCK:
+    case ND_COMMA:
+    case ND_CASE:
+    case ND_DEFAULT:
+      add_type(node->deep);
+      break;
+    default:
+      break;
+  }
   add_type(node->next);
-  add_type(node->deep);
 
   switch (node->kind) {
     case ND_VAR:
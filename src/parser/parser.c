@@ -86,7 +86,7 @@ static Node *constant(Token *tkn, Token **end_tkn);
 
 char *new_unique_label() {
   static int cnt = 0;
-  char *ptr = calloc(10, sizeof(char));
+  char *ptr = arena_calloc(&string_arena, 16, sizeof(char));
   sprintf(ptr, ".Luni%d", cnt++);
   return ptr;
 }
@@ -99,8 +99,16 @@ int align_to(int bytes, int align) {
   return bytes + (align - bytes % align) % align;
 }
 
+// Number of the nodes allocated, printed by "--stats" option
+static int64_t ast_nodes = 0;
+
+void print_ast_stats() {
+  fprintf(stderr, "ast nodes: %ld (%zu bytes each)\n", ast_nodes, sizeof(Node));
+}
+
 static Node *new_node(NodeKind kind, Token *tkn) {
-  Node *node = calloc(1, sizeof(Node));
+  Node *node = arena_calloc(&ast_arena, 1, sizeof(Node));
+  ast_nodes++;
   node->tkn = tkn;
   node->kind = kind;
   return node;
@@ -114,8 +122,7 @@ Node *new_num(Token *tkn, int64_t val) {
 }
 
 static Node *new_floating(Token *tkn, Type *ty, long double fval) {
-  Node *node = calloc(1, sizeof(Node));
-  node->kind = ND_NUM;
+  Node *node = new_node(ND_NUM, tkn);
   node->ty = ty;
   node->fval = fval;
   return node;
@@ -143,7 +150,7 @@ static void add_tmp_node(Node *node) {
 }
 
 static Node *new_strlit(Token *tkn) {
-  Initializer *init = new_initializer(tkn->ty, false);
+  Initializer *init = new_initializer(tkn->lit->ty, false);
 
   {
     Token *dummy;
@@ -154,9 +161,9 @@ static Node *new_strlit(Token *tkn) {
 
   Node head = {};
   Node *dummy = &head;
-  create_init_node(init, &dummy, true, tkn->ty);
+  create_init_node(init, &dummy, true, tkn->lit->ty);
 
-  node->lhs = new_var(tkn, new_obj(tkn->ty, new_unique_label()));
+  node->lhs = new_var(tkn, new_obj(tkn->lit->ty, new_unique_label()));
   node->lhs->var->is_global = true;
   node->rhs = head.lhs;
 
@@ -313,30 +320,32 @@ static Node *to_assign(Token *tkn, Node *rhs) {
   return new_assign(tkn, rhs->lhs, rhs);
 }
 
-static bool is_typename(Token *tkn) {
-  char *keywords[] = {
-    "void", "_Bool", "char", "short", "int", "long", "float", "double", "signed", "unsigned",
-    "const", "enum", "struct", "union", "auto", "static", "typedef"
-  };
+// Keywords which can start a declaration.
+static bool is_typename_kw[ID_END] = {
+  [KW_VOID] = true, [KW_BOOL] = true, [KW_CHAR] = true, [KW_SHORT] = true,
+  [KW_INT] = true, [KW_LONG] = true, [KW_FLOAT] = true, [KW_DOUBLE] = true,
+  [KW_SIGNED] = true, [KW_UNSIGNED] = true, [KW_CONST] = true, [KW_ENUM] = true,
+  [KW_STRUCT] = true, [KW_UNION] = true, [KW_AUTO] = true, [KW_STATIC] = true,
+  [KW_TYPEDEF] = true,
+};
 
-  for (int i = 0; i < sizeof(keywords) / sizeof(*keywords); i++) {
-    if (equal(tkn, keywords[i])) {
-      return true;
-    }
+static bool is_typename(Token *tkn) {
+  if (tkn->kind == TK_KEYWORD) {
+    return is_typename_kw[tkn->id];
   }
 
-  return find_type_def(strndup(tkn->loc, tkn->len));
+  return tkn->kind == TK_IDENT && find_type_def(get_atom(tkn)) != NULL;
 }
 
 // The type of array, structure, enum and a initializer end with '}' or ',' and '}'.
 static bool consume_close_brace(Token *tkn, Token **end_tkn) {
-  if (equal(tkn, "}")) {
-    *end_tkn = tkn->next;
+  if (equal_id(tkn, PN_RBRACE)) {
+    *end_tkn = next_token(tkn);
     return true;
   }
 
-  if (equal(tkn, ",") && equal(tkn->next, "}")) {
-    *end_tkn = tkn->next->next;
+  if (equal_id(tkn, PN_COMMA) && equal_id(next_token(tkn), PN_RBRACE)) {
+    *end_tkn = next_token(next_token(tkn));
     return true;
   }
 
@@ -350,15 +359,15 @@ static bool consume_close_brace(Token *tkn, Token **end_tkn) {
 //              identifier "=" constant-expression
 // constant-expression = conditional-expression
 static Type *enumspec(Token *tkn, Token **end_tkn) {
-  tkn = skip(tkn, "enum");
+  tkn = skip_id(tkn, KW_ENUM);
 
-  char *tag = NULL;
+  Atom *tag = NULL;
   if (tkn->kind == TK_IDENT) {
-    tag = get_ident(tkn);
-    tkn = tkn->next;
+    tag = get_atom(tkn);
+    tkn = next_token(tkn);
   }
 
-  if (tkn != NULL && !equal(tkn, "{")) {
+  if (tkn != NULL && !equal_id(tkn, PN_LBRACE)) {
     Type *ty = find_tag(tag);
 
     if (ty == NULL) {
@@ -377,15 +386,15 @@ static Type *enumspec(Token *tkn, Token **end_tkn) {
   Obj *cur = &head;
   int64_t val = -1;
 
-  tkn = skip(tkn, "{");
+  tkn = skip_id(tkn, PN_LBRACE);
   while (!consume_close_brace(tkn, &tkn)) {
     if (cur != &head) {
-      tkn = skip(tkn, ",");
+      tkn = skip_id(tkn, PN_COMMA);
     }
 
     char *ident = get_ident(tkn);
 
-    if (consume(tkn->next, &tkn, "=")) {
+    if (consume_id(next_token(tkn), &tkn, PN_ASSIGN)) {
       val = eval_expr(conditional(tkn, &tkn));
     } else {
       val++;
@@ -429,7 +438,7 @@ static void construct_members(Token *tkn, Token **end_tkn, Type *ty) {
   Member *cur = &head;
   int num_members = 0;
 
-  tkn = skip(tkn, "{");
+  tkn = skip_id(tkn, PN_LBRACE);
   while (!consume_close_brace(tkn, &tkn)) {
     if (!is_typename(tkn)) {
       errorf_tkn(ER_COMPILE, tkn, "Need type");
@@ -438,15 +447,15 @@ static void construct_members(Token *tkn, Token **end_tkn, Type *ty) {
     Type *base_ty = declspec(tkn, &tkn, NULL);
 
     bool need_comma = false;
-    while (!consume(tkn, &tkn, ";")) {
+    while (!consume_id(tkn, &tkn, PN_SEMICOLON)) {
       if (need_comma) {
-        tkn = skip(tkn, ",");
+        tkn = skip_id(tkn, PN_COMMA);
       }
       need_comma = true;
 
       Type *mem_ty = copy_type(declarator(tkn, &tkn, base_ty));
 
-      if (consume(tkn, &tkn, ":")) {
+      if (consume_id(tkn, &tkn, PN_COLON)) {
         if (mem_ty == NULL) {
           mem_ty = copy_type(base_ty);
         }
@@ -463,7 +472,7 @@ static void construct_members(Token *tkn, Token **end_tkn, Type *ty) {
       }
 
       check_member(head.next, mem_ty->name, mem_ty->tkn);
-      Member *member = calloc(1, sizeof(Member));
+      Member *member = arena_calloc(&type_arena, 1, sizeof(Member));
       member->ty = mem_ty;
       member->tkn = mem_ty->tkn;
       member->name = mem_ty->name;
@@ -540,25 +549,25 @@ static void union_specifier(Token *tkn, Token **end_tkn, Type *ty) {
 //
 static Type *stunspec(Token *tkn, Token **end_tkn) {
   TypeKind kind;
-  if (consume(tkn, &tkn, "struct")) {
+  if (consume_id(tkn, &tkn, KW_STRUCT)) {
     kind = TY_STRUCT;
-  } else if (consume(tkn, &tkn, "union")) {
+  } else if (consume_id(tkn, &tkn, KW_UNION)) {
     kind = TY_UNION;
   } else {
     return NULL;
   }
 
-  char *tag = NULL;
+  Atom *tag = NULL;
   if (tkn->kind == TK_IDENT) {
-    tag = get_ident(tkn);
-    tkn = tkn->next;
+    tag = get_atom(tkn);
+    tkn = next_token(tkn);
   }
 
-  if (tag != NULL && !equal(tkn, "{")) {
+  if (tag != NULL && !equal_id(tkn, PN_LBRACE)) {
     Type *ty = find_tag(tag);
 
     if (ty == NULL) {
-      ty = calloc(1, sizeof(Type));
+      ty = arena_calloc(&type_arena, 1, sizeof(Type));
       ty->tkn = tkn;
       ty->kind = kind;
       add_tag(ty, tag);
@@ -571,10 +580,11 @@ static Type *stunspec(Token *tkn, Token **end_tkn) {
   }
 
   if (tag == NULL) {
-    tag = new_unique_label();
+    char *label = new_unique_label();
+    tag = intern_atom(label, strlen(label));
   }
 
-  Type *ty = calloc(1, sizeof(Type));
+  Type *ty = arena_calloc(&type_arena, 1, sizeof(Type));
   ty->kind = kind;
   enforce_add_tag(ty, tag);
   ty = find_tag(tag);
@@ -584,6 +594,7 @@ static Type *stunspec(Token *tkn, Token **end_tkn) {
   } else {
     union_specifier(tkn, end_tkn, ty);
   }
+  complete_qualified_type(ty);
 
   return ty;
 }
@@ -621,74 +632,85 @@ static Type *declspec(Token *tkn, Token **end_tkn, VarAttr *attr) {
   bool is_const = false;
   Type *ty = NULL;
   while (is_typename(tkn)) {
-    if (equal(tkn, "const")) {
+    if (equal_id(tkn, KW_CONST)) {
       if (is_const) {
         errorf_tkn(ER_COMPILE, tkn, "Duplicate const");
       }
       is_const = true;
-      tkn = tkn->next;
+      tkn = next_token(tkn);
       continue;
     }
 
     // Check storage class specifier
-    if (equal(tkn, "static") || equal(tkn, "typedef")) {
+    if (equal_id(tkn, KW_STATIC) || equal_id(tkn, KW_TYPEDEF)) {
       if (attr == NULL) {
         errorf_tkn(ER_COMPILE, tkn, "Storage class specifier is not allowd in this context");
       }
 
-      if (equal(tkn, "static")) {
+      if (equal_id(tkn, KW_STATIC)) {
         attr->is_static = true;
-      } else if (equal(tkn, "typedef")) {
+      } else if (equal_id(tkn, KW_TYPEDEF)) {
         attr->is_type_def = true;
       }
 
-      tkn = tkn->next;
+      tkn = next_token(tkn);
       continue;
     }
 
     // Ignore these keywords
-    if (consume(tkn, &tkn, "auto")) {
+    if (consume_id(tkn, &tkn, KW_AUTO)) {
       continue;
     }
 
-    Type *type_def = find_type_def(strndup(tkn->loc, tkn->len));
-    if (type_def != NULL) {
-      ty = type_def;
-      tkn = tkn->next;
+    if (tkn->kind == TK_IDENT) {
+      ty = find_type_def(get_atom(tkn));
+      tkn = next_token(tkn);
       continue;
     }
 
     // Counting Types
-    if (equal(tkn,"void")) {
-      ty_cnt += VOID;
-    } else if (equal(tkn, "_Bool")) {
-      ty_cnt += BOOL;
-    } else if (equal(tkn, "char")) {
-      ty_cnt += CHAR;
-    } else if (equal(tkn, "short")) {
-      ty_cnt += SHORT;
-    } else if (equal(tkn, "int")) {
-      ty_cnt += INT;
-    } else if (equal(tkn, "long")) {
-      ty_cnt += LONG;
-    } else if (equal(tkn, "float")) {
-      ty_cnt += FLOAT;
-    } else if (equal(tkn, "double")) {
-      ty_cnt += DOUBLE;
-    } else if (equal(tkn, "signed")) {
-      ty_cnt += SIGNED;
-    } else if (equal(tkn, "unsigned")) {
-      ty_cnt += UNSIGNED;
-    }
-
-    if (equal(tkn, "enum")) {
-      ty = enumspec(tkn, &tkn)->base;
-      ty_cnt += OTHER;
-    }
-
-    if (equal(tkn, "struct") || equal(tkn, "union")) {
-      ty = stunspec(tkn, &tkn);
-      ty_cnt += OTHER;
+    switch (tkn->id) {
+      case KW_VOID:
+        ty_cnt += VOID;
+        break;
+      case KW_BOOL:
+        ty_cnt += BOOL;
+        break;
+      case KW_CHAR:
+        ty_cnt += CHAR;
+        break;
+      case KW_SHORT:
+        ty_cnt += SHORT;
+        break;
+      case KW_INT:
+        ty_cnt += INT;
+        break;
+      case KW_LONG:
+        ty_cnt += LONG;
+        break;
+      case KW_FLOAT:
+        ty_cnt += FLOAT;
+        break;
+      case KW_DOUBLE:
+        ty_cnt += DOUBLE;
+        break;
+      case KW_SIGNED:
+        ty_cnt += SIGNED;
+        break;
+      case KW_UNSIGNED:
+        ty_cnt += UNSIGNED;
+        break;
+      case KW_ENUM:
+        ty = enumspec(tkn, &tkn)->base;
+        ty_cnt += OTHER;
+        break;
+      case KW_STRUCT:
+      case KW_UNION:
+        ty = stunspec(tkn, &tkn);
+        ty_cnt += OTHER;
+        break;
+      default:
+        break;
     }
 
     switch (ty_cnt) {
@@ -752,9 +774,11 @@ static Type *declspec(Token *tkn, Token **end_tkn, VarAttr *attr) {
       default:
         errorf_tkn(ER_COMPILE, tkn, "Invalid type");
     }
-    tkn = tkn->next;
+    tkn = next_token(tkn);
+  }
+  if (is_const) {
+    ty = qualify_type(ty, true);
   }
-  ty->is_const = is_const;
 
  *end_tkn = tkn;
   return ty;
@@ -769,11 +793,11 @@ static Type *declspec(Token *tkn, Token **end_tkn, VarAttr *attr) {
 // Implement:
 // pointer = ("*" typequal*)*
 static Type *pointer(Token *tkn, Token **end_tkn, Type *ty) {
-  while (consume(tkn, &tkn, "*")) {
+  while (consume_id(tkn, &tkn, PN_MUL)) {
     ty = pointer_to(ty);
 
-    if (consume(tkn, &tkn, "const")) {
-      ty->is_const = true;
+    if (consume_id(tkn, &tkn, KW_CONST)) {
+      ty = qualify_type(ty, true);
     }
   }
 
@@ -782,7 +806,7 @@ static Type *pointer(Token *tkn, Token **end_tkn, Type *ty) {
 }
 
 static Type *new_vla(Token *tkn, Type *base, Node *node) {
-  Type *ty = calloc(1, sizeof(Type));
+  Type *ty = arena_calloc(&type_arena, 1, sizeof(Type));
   ty->kind = TY_VLA;
 
   if (base->vla_size == NULL) {
@@ -818,9 +842,9 @@ static Type *array_dimension(Token *tkn, Token **end_tkn, Type *ty) {
   int64_t val = 0;
   Node *node = NULL;
 
-  if (!consume(tkn, &tkn, "]")) {
+  if (!consume_id(tkn, &tkn, PN_RBRACKET)) {
     node = assign(tkn, &tkn);
-    tkn = skip(tkn, "]");
+    tkn = skip_id(tkn, PN_RBRACKET);
   }
 
   ty = type_suffix(tkn, end_tkn, ty);
@@ -831,6 +855,11 @@ static Type *array_dimension(Token *tkn, Token **end_tkn, Type *ty) {
     return array_to(ty, node == NULL ? 0 : eval_expr(node));
   }
 
+  // The array of a constant length is not a VLA, and it is interned.
+  if (ty->kind != TY_VLA && is_const_expr(node)) {
+    return array_to(ty, eval_expr(node));
+  }
+
   return new_vla(node->tkn, ty, node);
 }
 
@@ -839,17 +868,17 @@ static Type *array_dimension(Token *tkn, Token **end_tkn, Type *ty) {
 // param = declspec declarator
 static Type *param_list(Token *tkn, Token **end_tkn, Type *ty) {
   Type *ret_ty = ty;
-  ty = calloc(1, sizeof(Type));
+  ty = arena_calloc(&type_arena, 1, sizeof(Type));
   ty->kind = TY_FUNC;
   ty->ret_ty = ret_ty;
 
   Type head = {};
   Type *cur = &head;
 
-  consume(tkn, &tkn, "void");
-  while (!consume(tkn, &tkn, ")")) {
+  consume_id(tkn, &tkn, KW_VOID);
+  while (!consume_id(tkn, &tkn, PN_RPAREN)) {
     if (cur != &head) {
-      tkn = skip(tkn, ",");
+      tkn = skip_id(tkn, PN_COMMA);
     }
 
     Type *param_ty = declspec(tkn, &tkn, NULL);
@@ -876,13 +905,13 @@ static Type *param_list(Token *tkn, Token **end_tkn, Type *ty) {
 //               "(" param-list |
 //               None
 static Type *type_suffix(Token *tkn, Token **end_tkn, Type *ty) {
-  if (equal(tkn, "[")) {
-    return array_dimension(tkn->next, end_tkn, ty);
+  if (equal_id(tkn, PN_LBRACKET)) {
+    return array_dimension(next_token(tkn), end_tkn, ty);
   }
 
-  if (equal(tkn, "(")) {
+  if (equal_id(tkn, PN_LPAREN)) {
     enter_scope();
-    return param_list(tkn->next, end_tkn, ty);
+    return param_list(next_token(tkn), end_tkn, ty);
   }
 
   if (*end_tkn != NULL) *end_tkn = tkn;
@@ -898,15 +927,15 @@ static Type *type_suffix(Token *tkn, Token **end_tkn, Type *ty) {
 static Type *declarator(Token *tkn, Token **end_tkn, Type *ty) {
   ty = pointer(tkn, &tkn, ty);
 
-  if (equal(tkn, "(")) {
+  if (equal_id(tkn, PN_LPAREN)) {
     Token *head = tkn;
-    Type *new_ty = declarator(tkn->next, &tkn, ty);
+    Type *new_ty = declarator(next_token(tkn), &tkn, ty);
 
     if (new_ty == NULL) {
       tkn = head;
     } else {
       ty = new_ty;
-      tkn = skip(tkn, ")");
+      tkn = skip_id(tkn, PN_RPAREN);
 
       *end_tkn = tkn;
       return vla_to_arr(ty);
@@ -918,7 +947,12 @@ static Type *declarator(Token *tkn, Token **end_tkn, Type *ty) {
   }
 
   char *ident = get_ident(tkn);
-  ty = type_suffix(tkn->next, end_tkn, ty);
+  ty = type_suffix(next_token(tkn), end_tkn, ty);
+
+  // The pointer and array types are canonical types, which are not modified.
+  if (ty->kind == TY_PTR || ty->kind == TY_ARRAY) {
+    ty = copy_type(ty);
+  }
   ty->name = ident;
 
   return vla_to_arr(ty);
@@ -938,7 +972,7 @@ static Type *abstract_declarator(Token *tkn, Token **end_tkn, Type *ty) {
 }
 
 static Initializer *new_initializer(Type *ty, bool is_flexible) {
-  Initializer *init = calloc(1, sizeof(Initializer));
+  Initializer *init = arena_calloc(&ast_arena, 1, sizeof(Initializer));
   init->ty = ty;
 
   if (ty->kind == TY_ARRAY) {
@@ -948,7 +982,7 @@ static Initializer *new_initializer(Type *ty, bool is_flexible) {
     }
 
     init->size = ty->array_len;
-    init->children = calloc(ty->array_len, sizeof(Initializer *));
+    init->children = arena_calloc(&ast_arena, ty->array_len, sizeof(Initializer *));
     for (int i = 0; i < ty->array_len; i++) {
       init->children[i] = new_initializer(ty->base, false);
     }
@@ -956,7 +990,7 @@ static Initializer *new_initializer(Type *ty, bool is_flexible) {
 
   if (ty->kind == TY_STRUCT) {
     init->size = ty->num_members;
-    init->children = calloc(ty->num_members, sizeof(Initializer *));
+    init->children = arena_calloc(&ast_arena, ty->num_members, sizeof(Initializer *));
 
     int i = 0;
     for (Member *member = ty->members; member != NULL; member = member->next) {
@@ -966,21 +1000,21 @@ static Initializer *new_initializer(Type *ty, bool is_flexible) {
 
   if (ty->kind == TY_UNION) {
     init->size = 1;
-    init->children = calloc(1, sizeof(Initializer *));
+    init->children = arena_calloc(&ast_arena, 1, sizeof(Initializer *));
     init->children[0] = new_initializer(ty->members->ty, false);
   }
   return init;
 }
 
 static int count_array_init_elements(Token *tkn, Type *ty) {
-  tkn = skip(tkn, "{");
+  tkn = skip_id(tkn, PN_LBRACE);
 
   int cnt = 0;
   Initializer *dummy = new_initializer(ty->base, false);
 
   while (!consume_close_brace(tkn, &tkn)) {
     if (cnt != 0) {
-      tkn = skip(tkn, ",");
+      tkn = skip_id(tkn, PN_COMMA);
     }
 
     initializer_only(tkn, &tkn, dummy);
@@ -996,11 +1030,11 @@ static void string_initializer(Token *tkn, Token **end_tkn, Initializer *init) {
   // Otherwise, char number store in each elements of Array.
   if (init->ty->kind == TY_PTR) {
     init->node = new_strlit(tkn);
-   *end_tkn = tkn->next;
+   *end_tkn = next_token(tkn);
     return;
   }
 
-  int len = ((Type*)tkn->ty)->array_len;
+  int len = ((Type*)tkn->lit->ty)->array_len;
 
   if (init->is_flexible) {
     Initializer *tmp = new_initializer(array_to(init->ty->base, len), false);
@@ -1008,10 +1042,10 @@ static void string_initializer(Token *tkn, Token **end_tkn, Initializer *init) {
   }
 
   for (int idx = 0; idx < len; idx++) {
-    init->children[idx]->node = new_num(tkn, tkn->strlit[idx]);
+    init->children[idx]->node = new_num(tkn, tkn->lit->strlit[idx]);
   }
 
-  tkn = tkn->next;
+  tkn = next_token(tkn);
  *end_tkn = tkn;
 }
 
@@ -1024,23 +1058,23 @@ static void initializer_list(Token *tkn, Token **end_tkn, Initializer *init) {
     *init = *new_initializer(array_to(init->ty->base, size), false);
   }
 
-  tkn = skip(tkn, "{");
+  tkn = skip_id(tkn, PN_LBRACE);
   Type *ty = init->ty;
   int idx = 0;
 
   while (!consume_close_brace(tkn, &tkn)) {
     if (idx != 0) {
-      tkn = skip(tkn, ",");
+      tkn = skip_id(tkn, PN_COMMA);
     }
 
-    if (ty->kind == TY_ARRAY && consume(tkn, &tkn, "[")) {
+    if (ty->kind == TY_ARRAY && consume_id(tkn, &tkn, PN_LBRACKET)) {
       int val = eval_expr(conditional(tkn, &tkn));
-      tkn = skip(tkn, "]");
-      tkn = skip(tkn, "=");
+      tkn = skip_id(tkn, PN_RBRACKET);
+      tkn = skip_id(tkn, PN_ASSIGN);
       idx = val;
     }
 
-    if (is_struct_type(ty) && consume(tkn, &tkn, ".")) {
+    if (is_struct_type(ty) && consume_id(tkn, &tkn, PN_DOT)) {
       char *ident = get_ident(tkn);
       int i = 0;
       Type *member_ty;
@@ -1051,7 +1085,7 @@ static void initializer_list(Token *tkn, Token **end_tkn, Initializer *init) {
         }
         i++;
       }
-      tkn = skip(tkn->next, "=");
+      tkn = skip_id(next_token(tkn), PN_ASSIGN);
       if (ty->kind == TY_UNION) {
         idx = 0;
         init->children[0]->ty = member_ty;
@@ -1079,7 +1113,7 @@ static void initializer_only(Token *tkn, Token **end_tkn, Initializer *init) {
     return;
   }
 
-  if (equal(tkn, "{")) {
+  if (equal_id(tkn, PN_LBRACE)) {
     initializer_list(tkn, end_tkn, init);
     return;
   }
@@ -1111,7 +1145,7 @@ static void create_init_node(Initializer *init, Node **connect, bool only_const,
         node->init = new_num(init->node->tkn, eval_expr2(node->init, &label));
       }
 
-      node->init->var = calloc(1, sizeof(Obj));
+      node->init->var = arena_calloc(&ast_arena, 1, sizeof(Obj));
       node->init->var->name = label;
     }
 
@@ -1384,9 +1418,9 @@ static Node *declaration(Token *tkn, Token **end_tkn, Type *base_ty, bool is_glo
   Node head = {};
   Node *cur = &head;
 
-  while (!consume(tkn, &tkn, ";")) {
+  while (!consume_id(tkn, &tkn, PN_SEMICOLON)) {
     if (cur != &head) {
-      tkn = skip(tkn, ",");
+      tkn = skip_id(tkn, PN_COMMA);
     }
     cur->next = initdecl(tkn, &tkn, base_ty, is_global, attr);
     cur = cur->next;
@@ -1403,7 +1437,7 @@ static Node *initdecl(Token *tkn, Token **end_tkn, Type *ty, bool is_global, Var
   if (attr->is_type_def) {
     char *name = ty->name;
     ty->name = NULL;
-    add_type_def(ty, name);
+    add_type_def(ty, intern_atom(name, strlen(name)));
 
    *end_tkn = tkn;
     return new_node(ND_VOID, tkn);
@@ -1450,8 +1484,8 @@ static Node *initdecl(Token *tkn, Token **end_tkn, Type *ty, bool is_global, Var
     add_var(obj, !is_global);
   }
 
-  if (equal(tkn, "=")) {
-    Initializer *init = initializer(tkn->next, &tkn, obj->ty);
+  if (equal_id(tkn, PN_ASSIGN)) {
+    Initializer *init = initializer(next_token(tkn), &tkn, obj->ty);
     obj->ty = init->ty;
 
     Node head = {};
@@ -1509,7 +1543,7 @@ Node *program(Token *tkn) {
       errorf_tkn(ER_COMPILE, tkn, "Need type name");
     }
 
-    VarAttr *attr = calloc(1, sizeof(VarAttr));
+    VarAttr *attr = arena_calloc(&ast_arena, 1, sizeof(VarAttr));
     Type *ty = declspec(tkn, &tkn, attr);
     Node *node = funcdef(tkn, &tkn, copy_type(ty), attr);
     if (node == NULL) {
@@ -1538,7 +1572,7 @@ static Node *funcdef(Token *tkn, Token **end_tkn, Type *base_ty, VarAttr *attr)
   label_map = calloc(1, sizeof(HashMap));
 
   Type *ty = declarator(tkn, &tkn, base_ty);
-  if (!equal(tkn, "{")) {
+  if (!equal_id(tkn, PN_LBRACE)) {
     if (ty != NULL && ty->kind == TY_FUNC) {
       leave_scope();
       init_offset();
@@ -1563,7 +1597,7 @@ static Node *funcdef(Token *tkn, Token **end_tkn, Type *base_ty, VarAttr *attr)
       vla_init_node = vla_init_node->next;
     }
 
-    cur->next = find_var(param->name);
+    cur->next = find_var(intern_atom(param->name, strlen(param->name)));
     cur = cur->next;
   }
 
@@ -1579,7 +1613,7 @@ static Node *funcdef(Token *tkn, Token **end_tkn, Type *base_ty, VarAttr *attr)
   vla_init_node->next = node->deep->deep;
   node->deep->deep = vla_init_head.next;
 
-  Obj *func = find_var(ty->name);
+  Obj *func = find_var(intern_atom(ty->name, strlen(ty->name)));
   node->func = func;
   node->func->vars_size = init_offset();
   node->func->ty->var_size = node->func->vars_size;
@@ -1623,7 +1657,7 @@ static Node *funcdef(Token *tkn, Token **end_tkn, Type *base_ty, VarAttr *attr)
 //                        "return" expr? ";"
 // expression-statement = expression? ";"
 static Node *statement(Token *tkn, Token **end_tkn) {
-  if (tkn->kind == TK_IDENT && equal(tkn->next, ":")) {
+  if (tkn->kind == TK_IDENT && equal_id(next_token(tkn), PN_COLON)) {
     Node *node = new_node(ND_LABEL, tkn);
     node->label = get_ident(tkn);
 
@@ -1631,7 +1665,7 @@ static Node *statement(Token *tkn, Token **end_tkn) {
       errorf_tkn(ER_COMPILE, tkn, "Duplicate label");
     }
     hashmap_insert(label_map, node->label, new_unique_label());
-    tkn = skip(tkn->next, ":");
+    tkn = skip_id(next_token(tkn), PN_COLON);
 
     node->deep = label_node;
     label_node = node;
@@ -1641,10 +1675,10 @@ static Node *statement(Token *tkn, Token **end_tkn) {
   }
 
   // labeled-statement
-  if (equal(tkn, "case")) {
+  if (equal_id(tkn, KW_CASE)) {
     Node *node = new_node(ND_CASE, tkn);
-    node->val = eval_expr(conditional(tkn->next, &tkn));
-    tkn = skip(tkn, ":");
+    node->val = eval_expr(conditional(next_token(tkn), &tkn));
+    tkn = skip_id(tkn, PN_COLON);
 
     enter_scope();
     node->deep = statement(tkn, end_tkn);
@@ -1653,9 +1687,9 @@ static Node *statement(Token *tkn, Token **end_tkn) {
     return node;
   }
 
-  if (equal(tkn, "default")) {
+  if (equal_id(tkn, KW_DEFAULT)) {
     Node *node = new_node(ND_DEFAULT, tkn);
-    tkn = skip(tkn->next, ":");
+    tkn = skip_id(next_token(tkn), PN_COLON);
 
     enter_scope();
     node->deep = statement(tkn, end_tkn);
@@ -1672,19 +1706,19 @@ static Node *statement(Token *tkn, Token **end_tkn) {
   }
 
   // selection-statement
-  if (equal(tkn, "if")) {
-    tkn = skip(tkn->next, "(");
+  if (equal_id(tkn, KW_IF)) {
+    tkn = skip_id(next_token(tkn), PN_LPAREN);
     Node *ret = new_node(ND_IF, tkn);
     ret->cond = assign(tkn, &tkn);
-    tkn = skip(tkn, ")");
+    tkn = skip_id(tkn, PN_RPAREN);
 
     enter_scope();
     ret->then = statement(tkn, &tkn);
     leave_scope();
 
-    if (equal(tkn, "else")) {
+    if (equal_id(tkn, KW_ELSE)) {
       enter_scope();
-      ret->other = statement(tkn->next, &tkn);
+      ret->other = statement(next_token(tkn), &tkn);
       leave_scope();
     }
 
@@ -1693,19 +1727,19 @@ static Node *statement(Token *tkn, Token **end_tkn) {
   }
 
   // selection-statement
-  if (equal(tkn, "switch")) {
+  if (equal_id(tkn, KW_SWITCH)) {
     char *break_store = break_label;
 
     Node *node = new_node(ND_SWITCH, tkn);
     break_label = node->break_label = new_unique_label();
 
-    tkn = skip(tkn->next, "(");
+    tkn = skip_id(next_token(tkn), PN_LPAREN);
     node->cond = expr(tkn, &tkn);
     add_type(node->cond);
     if (!is_integer_type(node->cond->ty)) {
       errorf_tkn(ER_COMPILE, tkn, "Statemnet require expression of integer type");
     }
-    tkn = skip(tkn, ")");
+    tkn = skip_id(tkn, PN_RPAREN);
     
     enter_scope();
     Node *stmt = statement(tkn, end_tkn);
@@ -1744,8 +1778,8 @@ static Node *statement(Token *tkn, Token **end_tkn) {
   }
 
   // iteration-statement
-  if (equal(tkn, "while")) {
-    tkn = skip(tkn->next, "(");
+  if (equal_id(tkn, KW_WHILE)) {
+    tkn = skip_id(next_token(tkn), PN_LPAREN);
     enter_scope();
 
     char *break_store = break_label;
@@ -1757,7 +1791,7 @@ static Node *statement(Token *tkn, Token **end_tkn) {
 
     ret->cond = expr(tkn, &tkn);
 
-    tkn = skip(tkn, ")");
+    tkn = skip_id(tkn, PN_RPAREN);
 
     ret->then = statement(tkn, &tkn);
     leave_scope();
@@ -1769,7 +1803,7 @@ static Node *statement(Token *tkn, Token **end_tkn) {
   }
 
   // iteration-statement
-  if (equal(tkn, "do")) {
+  if (equal_id(tkn, KW_DO)) {
     char *break_store = break_label;
     char *conti_store = conti_label;
 
@@ -1778,12 +1812,12 @@ static Node *statement(Token *tkn, Token **end_tkn) {
     conti_label = node->conti_label = new_unique_label();
 
     enter_scope();
-    node->then = statement(tkn->next, &tkn);
+    node->then = statement(next_token(tkn), &tkn);
     leave_scope();
 
-    tkn = skip(skip(tkn, "while"), "(");
+    tkn = skip_id(skip_id(tkn, KW_WHILE), PN_LPAREN);
     node->cond = expr(tkn, &tkn);
-    tkn = skip(skip(tkn, ")"), ";");
+    tkn = skip_id(skip_id(tkn, PN_RPAREN), PN_SEMICOLON);
 
     break_label = break_store;
     conti_label = conti_store;
@@ -1792,8 +1826,8 @@ static Node *statement(Token *tkn, Token **end_tkn) {
   }
 
   // iteration-statement
-  if (equal(tkn, "for")) {
-    tkn = skip(tkn->next, "(");
+  if (equal_id(tkn, KW_FOR)) {
+    tkn = skip_id(next_token(tkn), PN_LPAREN);
     enter_scope();
 
     char *break_store = break_label;
@@ -1804,22 +1838,22 @@ static Node *statement(Token *tkn, Token **end_tkn) {
     conti_label = ret->conti_label = new_unique_label();
 
     if (is_typename(tkn)) {
-      VarAttr *attr = calloc(1, sizeof(VarAttr));
+      VarAttr *attr = arena_calloc(&ast_arena, 1, sizeof(VarAttr));
       Type *ty = declspec(tkn, &tkn, attr);
       ret->init = declaration(tkn, &tkn, ty, false, attr);
-    } else if (!consume(tkn, &tkn, ";")) {
+    } else if (!consume_id(tkn, &tkn, PN_SEMICOLON)) {
       ret->init = expr(tkn, &tkn);
-      tkn = skip(tkn, ";");
+      tkn = skip_id(tkn, PN_SEMICOLON);
     }
 
-    if (!consume(tkn, &tkn, ";")) {
+    if (!consume_id(tkn, &tkn, PN_SEMICOLON)) {
       ret->cond = expr(tkn, &tkn);
-      tkn = skip(tkn, ";");
+      tkn = skip_id(tkn, PN_SEMICOLON);
     }
 
-    if (!consume(tkn, &tkn, ")")) {
+    if (!consume_id(tkn, &tkn, PN_RPAREN)) {
       ret->loop = assign(tkn, &tkn);
-      tkn = skip(tkn, ")");
+      tkn = skip_id(tkn, PN_RPAREN);
     }
 
     ret->then = statement(tkn, &tkn);
@@ -1832,65 +1866,65 @@ static Node *statement(Token *tkn, Token **end_tkn) {
   }
 
   // jump-statement
-  if (equal(tkn, "goto")) {
+  if (equal_id(tkn, KW_GOTO)) {
     Node *node = new_node(ND_GOTO, tkn);
-    node->label = get_ident(tkn->next);
+    node->label = get_ident(next_token(tkn));
     node->deep = goto_node;
     goto_node = node;
 
-    tkn = skip(tkn->next->next, ";");
+    tkn = skip_id(next_token(next_token(tkn)), PN_SEMICOLON);
    *end_tkn = tkn;
     return node;
   }
 
   // jump-statement
-  if (equal(tkn, "continue")) {
+  if (equal_id(tkn, KW_CONTINUE)) {
     if (conti_label == NULL) {
       errorf_tkn(ER_COMPILE, tkn, "There is no jump destination");
     }
 
     Node *ret = new_node(ND_CONTINUE, tkn);
     ret->conti_label = conti_label;
-    tkn = skip(tkn->next, ";");
+    tkn = skip_id(next_token(tkn), PN_SEMICOLON);
 
    *end_tkn = tkn;
     return ret;
   }
 
   // jump-statement
-  if (equal(tkn, "break")) {
+  if (equal_id(tkn, KW_BREAK)) {
     if (break_label == NULL) {
       errorf_tkn(ER_COMPILE, tkn, "There is no jump destination");
     }
 
     Node *ret = new_node(ND_BREAK, tkn);
     ret->break_label = break_label;
-    tkn = skip(tkn->next, ";");
+    tkn = skip_id(next_token(tkn), PN_SEMICOLON);
 
    *end_tkn = tkn;
     return ret;
   }
 
   // jump-statement
-  if (equal(tkn, "return")) {
+  if (equal_id(tkn, KW_RETURN)) {
     Node *node = new_node(ND_RETURN, tkn);
-    node->lhs = assign(tkn->next, &tkn);
+    node->lhs = assign(next_token(tkn), &tkn);
     add_type(node);
     node->ty = func_ty;
 
     if (!is_same_type(func_ty->ret_ty, node->lhs->ty)) {
       node->lhs = new_cast(node->lhs, func_ty->ret_ty);
     }
-    tkn = skip(tkn, ";");
+    tkn = skip_id(tkn, PN_SEMICOLON);
 
    *end_tkn = tkn;
     return node;
   }
 
   // expression-statement
-  while (consume(tkn, &tkn, ";"));
+  while (consume_id(tkn, &tkn, PN_SEMICOLON));
   node = expr(tkn, &tkn);
-  tkn = skip(tkn, ";");
+  tkn = skip_id(tkn, PN_SEMICOLON);
 
  *end_tkn = tkn;
   return node;
@@ -1899,15 +1933,15 @@ static Node *statement(Token *tkn, Token **end_tkn) {
 // compound-statement = "{" ( declaration | statement )* "}"
 //                    -> "{" (declspec declaration | statement )* "}"
 static Node *comp_stmt(Token *tkn, Token **end_tkn) {
-  if (consume(tkn, &tkn, "{")) {
+  if (consume_id(tkn, &tkn, PN_LBRACE)) {
     Node *ret = new_node(ND_BLOCK, tkn);
 
     Node head = {};
     Node *cur = &head;
 
-    while (!consume(tkn, &tkn, "}")) {
+    while (!consume_id(tkn, &tkn, PN_RBRACE)) {
       if (is_typename(tkn)) {
-        VarAttr *attr = calloc(1, sizeof(VarAttr));
+        VarAttr *attr = arena_calloc(&ast_arena, 1, sizeof(VarAttr));
         Type *ty = declspec(tkn, &tkn, attr);
         cur->next = declaration(tkn, &tkn, ty, false, attr);
       } else {
@@ -1935,7 +1969,7 @@ static Node *expr(Token *tkn, Token **end_tkn) {
   Node *cur = &head;
 
   while (true) {
-    if (cur != &head && !consume(tkn, &tkn, ",")) {
+    if (cur != &head && !consume_id(tkn, &tkn, PN_COMMA)) {
       break;
     }
 
@@ -1965,48 +1999,48 @@ static Node *expr(Token *tkn, Token **end_tkn) {
 static Node *assign(Token *tkn, Token **end_tkn) {
   Node *node = conditional(tkn, &tkn);
 
-  if (equal(tkn, "=")) {
-    return new_assign(tkn, node, assign(tkn->next, end_tkn));
+  if (equal_id(tkn, PN_ASSIGN)) {
+    return new_assign(tkn, node, assign(next_token(tkn), end_tkn));
   }
 
-  if (equal(tkn, "+=")) {
-    return to_assign(tkn, new_add(tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_ADD_ASSIGN)) {
+    return to_assign(tkn, new_add(tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, "-=")) {
-    return to_assign(tkn, new_sub(tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_SUB_ASSIGN)) {
+    return to_assign(tkn, new_sub(tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, "*=")) {
-    return to_assign(tkn, new_calc(ND_MUL, tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_MUL_ASSIGN)) {
+    return to_assign(tkn, new_calc(ND_MUL, tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, "/=")) {
-    return to_assign(tkn, new_calc(ND_DIV, tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_DIV_ASSIGN)) {
+    return to_assign(tkn, new_calc(ND_DIV, tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, "%=")) {
-    return to_assign(tkn, new_calc(ND_REMAINDER, tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_MOD_ASSIGN)) {
+    return to_assign(tkn, new_calc(ND_REMAINDER, tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, "<<=")) {
-    return to_assign(tkn, new_calc(ND_LEFTSHIFT, tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_SHL_ASSIGN)) {
+    return to_assign(tkn, new_calc(ND_LEFTSHIFT, tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, ">>=")) {
-    return to_assign(tkn, new_calc(ND_RIGHTSHIFT, tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_SHR_ASSIGN)) {
+    return to_assign(tkn, new_calc(ND_RIGHTSHIFT, tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, "&=")) {
-    return to_assign(tkn, new_calc(ND_BITWISEAND, tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_AND_ASSIGN)) {
+    return to_assign(tkn, new_calc(ND_BITWISEAND, tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, "^=")) {
-    return to_assign(tkn, new_calc(ND_BITWISEXOR, tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_XOR_ASSIGN)) {
+    return to_assign(tkn, new_calc(ND_BITWISEXOR, tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
-  if (equal(tkn, "|=")) {
-    return to_assign(tkn, new_calc(ND_BITWISEOR, tkn, node, assign(tkn->next, end_tkn)));
+  if (equal_id(tkn, PN_OR_ASSIGN)) {
+    return to_assign(tkn, new_calc(ND_BITWISEOR, tkn, node, assign(next_token(tkn), end_tkn)));
   }
 
   add_type(node);
@@ -2019,12 +2053,12 @@ static Node *assign(Token *tkn, Token **end_tkn) {
 static Node *conditional(Token *tkn, Token **end_tkn) {
   Node *node = logical_or(tkn, &tkn);
 
-  if (equal(tkn, "?")) {
+  if (equal_id(tkn, PN_QUESTION)) {
     Node *cond_expr = new_node(ND_COND, tkn);
     cond_expr->cond = node;
-    cond_expr->lhs = expr(tkn->next, &tkn);
+    cond_expr->lhs = expr(next_token(tkn), &tkn);
     
-    tkn = skip(tkn, ":");
+    tkn = skip_id(tkn, PN_COLON);
 
     cond_expr->rhs = conditional(tkn, &tkn);
     node = cond_expr;
@@ -2042,9 +2076,9 @@ static Node *conditional(Token *tkn, Token **end_tkn) {
 static Node *logical_or(Token *tkn, Token **end_tkn) {
   Node *ret = logical_and(tkn, &tkn);
 
-  while (equal(tkn, "||")) {
+  while (equal_id(tkn, PN_LOGOR)) {
     Token *operand = tkn;
-    ret = new_calc(ND_LOGICALOR, operand, ret, logical_and(tkn->next, &tkn));
+    ret = new_calc(ND_LOGICALOR, operand, ret, logical_and(next_token(tkn), &tkn));
     ret->lhs = new_calc(ND_NEQ, operand, ret->lhs, new_num(operand, 0));
     ret->rhs = new_calc(ND_NEQ, operand, ret->rhs, new_num(operand, 0));
   }
@@ -2061,9 +2095,9 @@ static Node *logical_or(Token *tkn, Token **end_tkn) {
 static Node *logical_and(Token *tkn, Token **end_tkn) {
   Node *ret = bitor(tkn, &tkn);
 
-  while (equal(tkn, "&&")) {
+  while (equal_id(tkn, PN_LOGAND)) {
     Token *operand = tkn;
-    ret = new_calc(ND_LOGICALAND, operand, ret, bitor(tkn->next, &tkn));
+    ret = new_calc(ND_LOGICALAND, operand, ret, bitor(next_token(tkn), &tkn));
     ret->lhs = new_calc(ND_NEQ, operand, ret->lhs, new_num(operand, 0));
     ret->rhs = new_calc(ND_NEQ, operand, ret->rhs, new_num(operand, 0));
   }
@@ -2080,9 +2114,9 @@ static Node *logical_and(Token *tkn, Token **end_tkn) {
 static Node *bitor(Token *tkn, Token **end_tkn) {
   Node *ret = bitxor(tkn, &tkn);
 
-  while (equal(tkn, "|")) {
+  while (equal_id(tkn, PN_OR)) {
     Token *operand = tkn;
-    ret = new_calc(ND_BITWISEOR, operand, ret, bitxor(tkn->next, &tkn));
+    ret = new_calc(ND_BITWISEOR, operand, ret, bitxor(next_token(tkn), &tkn));
   }
 
  *end_tkn = tkn;
@@ -2097,9 +2131,9 @@ static Node *bitor(Token *tkn, Token **end_tkn) {
 static Node *bitxor(Token *tkn, Token **end_tkn) {
   Node *ret = bitand(tkn, &tkn);
 
-  while (equal(tkn, "^")) {
+  while (equal_id(tkn, PN_XOR)) {
     Token *operand = tkn;
-    ret = new_calc(ND_BITWISEXOR, operand, ret, bitand(tkn->next, &tkn));
+    ret = new_calc(ND_BITWISEXOR, operand, ret, bitand(next_token(tkn), &tkn));
   }
 
  *end_tkn = tkn;
@@ -2114,9 +2148,9 @@ static Node *bitxor(Token *tkn, Token **end_tkn) {
 static Node *bitand(Token *tkn, Token **end_tkn) {
   Node *ret = equality(tkn, &tkn);
 
-  while (equal(tkn, "&")) {
+  while (equal_id(tkn, PN_AND)) {
     Token *operand = tkn;
-    ret = new_calc(ND_BITWISEAND, operand, ret, equality(tkn->next, &tkn));
+    ret = new_calc(ND_BITWISEAND, operand, ret, equality(next_token(tkn), &tkn));
   }
 
  *end_tkn = tkn;
@@ -2132,12 +2166,12 @@ static Node *bitand(Token *tkn, Token **end_tkn) {
 static Node *equality(Token *tkn, Token **end_tkn) {
   Node *node = relational(tkn, &tkn);
 
-  while (equal(tkn, "==") || equal(tkn, "!=")) {
-    NodeKind kind = equal(tkn, "==") ? ND_EQ : ND_NEQ;
+  while (equal_id(tkn, PN_EQ) || equal_id(tkn, PN_NE)) {
+    NodeKind kind = equal_id(tkn, PN_EQ) ? ND_EQ : ND_NEQ;
 
     Node *eq_expr = new_node(kind, tkn);
     eq_expr->lhs = node;
-    eq_expr->rhs = relational(tkn->next, &tkn);
+    eq_expr->rhs = relational(next_token(tkn), &tkn);
     node = eq_expr;
   }
 
@@ -2156,18 +2190,18 @@ static Node *equality(Token *tkn, Token **end_tkn) {
 static Node *relational(Token *tkn, Token **end_tkn) {
   Node *node = bitshift(tkn, &tkn);
 
-  while (equal(tkn, "<") || equal(tkn, ">") ||
-         equal(tkn, "<=") || equal(tkn, ">=")) {
-    NodeKind kind = equal(tkn, "<") || equal(tkn, ">") ? ND_LC : ND_LEC;
+  while (equal_id(tkn, PN_LT) || equal_id(tkn, PN_GT) ||
+         equal_id(tkn, PN_LE) || equal_id(tkn, PN_GE)) {
+    NodeKind kind = equal_id(tkn, PN_LT) || equal_id(tkn, PN_GT) ? ND_LC : ND_LEC;
 
     Node *rel_expr = new_node(kind, tkn);
 
-    if (equal(tkn, ">") || equal(tkn, ">=")) {
-      rel_expr->lhs = bitshift(tkn->next, &tkn);
+    if (equal_id(tkn, PN_GT) || equal_id(tkn, PN_GE)) {
+      rel_expr->lhs = bitshift(next_token(tkn), &tkn);
       rel_expr->rhs = node;
     } else {
       rel_expr->lhs = node;
-      rel_expr->rhs = bitshift(tkn->next, &tkn);
+      rel_expr->rhs = bitshift(next_token(tkn), &tkn);
     }
     node = rel_expr;
   }
@@ -2185,10 +2219,10 @@ static Node *relational(Token *tkn, Token **end_tkn) {
 static Node *bitshift(Token *tkn, Token **end_tkn) {
   Node *ret = add(tkn, &tkn);
 
-  while (equal(tkn, "<<") || equal(tkn, ">>")) {
-    NodeKind kind = equal(tkn, "<<") ? ND_LEFTSHIFT : ND_RIGHTSHIFT;
+  while (equal_id(tkn, PN_SHL) || equal_id(tkn, PN_SHR)) {
+    NodeKind kind = equal_id(tkn, PN_SHL) ? ND_LEFTSHIFT : ND_RIGHTSHIFT;
     Token *operand = tkn;
-    ret = new_calc(kind, operand, ret, add(tkn->next, &tkn));
+    ret = new_calc(kind, operand, ret, add(next_token(tkn), &tkn));
   }
 
  *end_tkn = tkn;
@@ -2205,14 +2239,14 @@ static Node *bitshift(Token *tkn, Token **end_tkn) {
 static Node *add(Token *tkn, Token **end_tkn) {
   Node *ret = mul(tkn, &tkn);
 
-  while (equal(tkn, "+") || equal(tkn, "-")) {
+  while (equal_id(tkn, PN_ADD) || equal_id(tkn, PN_SUB)) {
     Token *operand = tkn;
-    if (equal(tkn, "+")) {
-      ret = new_add(operand, ret, mul(tkn->next, &tkn));
+    if (equal_id(tkn, PN_ADD)) {
+      ret = new_add(operand, ret, mul(next_token(tkn), &tkn));
     }
 
-    if (equal(tkn, "-")) {
-      ret = new_sub(operand, ret, mul(tkn->next, &tkn));
+    if (equal_id(tkn, PN_SUB)) {
+      ret = new_sub(operand, ret, mul(next_token(tkn), &tkn));
     }
   }
 
@@ -2230,12 +2264,12 @@ static Node *add(Token *tkn, Token **end_tkn) {
 static Node *mul(Token *tkn, Token **end_tkn) {
   Node *node = cast(tkn, &tkn);
 
-  while (equal(tkn, "*") || equal(tkn, "/") || equal(tkn, "%")) {
+  while (equal_id(tkn, PN_MUL) || equal_id(tkn, PN_DIV) || equal_id(tkn, PN_MOD)) {
     NodeKind kind = ND_VOID;
 
-    if (equal(tkn, "*")) {
+    if (equal_id(tkn, PN_MUL)) {
       kind = ND_MUL;
-    } else if (equal(tkn, "/")) {
+    } else if (equal_id(tkn, PN_DIV)) {
       kind = ND_DIV;
     } else {
       kind = ND_REMAINDER;
@@ -2243,7 +2277,7 @@ static Node *mul(Token *tkn, Token **end_tkn) {
 
     Node *mul_node = new_node(kind, tkn);
     mul_node->lhs = node;
-    mul_node->rhs = cast(tkn->next, &tkn);
+    mul_node->rhs = cast(next_token(tkn), &tkn);
     
     node = mul_node;
   }
@@ -2257,11 +2291,11 @@ static Node *mul(Token *tkn, Token **end_tkn) {
 //
 // The definition of typename is shown in the comments of the function below.
 static Node *cast(Token *tkn, Token **end_tkn) {
-  if (equal(tkn, "(") && is_typename(tkn->next)) {
-    Type *ty = declspec(tkn->next, &tkn, NULL);
+  if (equal_id(tkn, PN_LPAREN) && is_typename(next_token(tkn))) {
+    Type *ty = declspec(next_token(tkn), &tkn, NULL);
     ty = abstract_declarator(tkn, &tkn, ty);
 
-    tkn = skip(tkn, ")");
+    tkn = skip_id(tkn, PN_RPAREN);
     return new_cast(cast(tkn, end_tkn), ty);
   }
   return unary(tkn, end_tkn);
@@ -2281,59 +2315,59 @@ static Node *cast(Token *tkn, Token **end_tkn) {
 // typename =  specifier-qualifier-list abstruct-declarator?
 //          -> declspec abstract-declarator
 static Node *unary(Token *tkn, Token **end_tkn) {
-  if (equal(tkn, "++")) {
-    Node *node = to_assign(tkn, new_add(tkn, unary(tkn->next, end_tkn), new_num(tkn, 1)));
+  if (equal_id(tkn, PN_INC)) {
+    Node *node = to_assign(tkn, new_add(tkn, unary(next_token(tkn), end_tkn), new_num(tkn, 1)));
     node->next = node->lhs;
     return new_commma(tkn, node);
   }
 
-  if (equal(tkn, "--")) {
-    Node *node = to_assign(tkn, new_sub(tkn, unary(tkn->next, end_tkn), new_num(tkn, 1)));
+  if (equal_id(tkn, PN_DEC)) {
+    Node *node = to_assign(tkn, new_sub(tkn, unary(next_token(tkn), end_tkn), new_num(tkn, 1)));
     node->next = node->lhs;
     return new_commma(tkn, node);
   }
 
   // unary-operator
-  if (equal(tkn, "&")) {
+  if (equal_id(tkn, PN_AND)) {
     Node *node = new_node(ND_ADDR, tkn);
-    node->lhs = cast(tkn->next, end_tkn);
+    node->lhs = cast(next_token(tkn), end_tkn);
     return node;
   }
 
-  if (equal(tkn, "*")) {
+  if (equal_id(tkn, PN_MUL)) {
     Node *node = new_node(ND_CONTENT, tkn);
-    node->lhs = cast(tkn->next, end_tkn);
+    node->lhs = cast(next_token(tkn), end_tkn);
     return node;
   }
 
-  if (equal(tkn, "+") || equal(tkn, "-")) {
-    NodeKind kind = equal(tkn, "+") ? ND_ADD : ND_SUB;
+  if (equal_id(tkn, PN_ADD) || equal_id(tkn, PN_SUB)) {
+    NodeKind kind = equal_id(tkn, PN_ADD) ? ND_ADD : ND_SUB;
     Node *node = new_node(kind, tkn);
     node->lhs = new_num(tkn, 0);
-    node->rhs = cast(tkn->next, end_tkn);
+    node->rhs = cast(next_token(tkn), end_tkn);
     return node;
   }
 
-  if (equal(tkn, "~")) {
+  if (equal_id(tkn, PN_TILDE)) {
     Node *node = new_node(ND_BITWISENOT, tkn);
-    node->lhs = cast(tkn->next, end_tkn);
+    node->lhs = cast(next_token(tkn), end_tkn);
     return node;
   }
 
-  if (equal(tkn, "!")) {
-    return new_calc(ND_EQ, tkn, cast(tkn->next, end_tkn), new_num(tkn, 0));
+  if (equal_id(tkn, PN_NOT)) {
+    return new_calc(ND_EQ, tkn, cast(next_token(tkn), end_tkn), new_num(tkn, 0));
   }
 
-  if (equal(tkn, "sizeof") || equal(tkn, "_Alignof")) {
-    bool is_sizeof = equal(tkn, "sizeof");
-    tkn = tkn->next;
+  if (equal_id(tkn, KW_SIZEOF) || equal_id(tkn, KW_ALIGNOF)) {
+    bool is_sizeof = equal_id(tkn, KW_SIZEOF);
+    tkn = next_token(tkn);
 
     // type-name
-    if (equal(tkn, "(") && is_typename(tkn->next)) {
-      Type *ty = declspec(tkn->next, &tkn, NULL);
+    if (equal_id(tkn, PN_LPAREN) && is_typename(next_token(tkn))) {
+      Type *ty = declspec(next_token(tkn), &tkn, NULL);
       ty = abstract_declarator(tkn, &tkn, ty);
 
-      tkn = skip(tkn, ")");
+      tkn = skip_id(tkn, PN_RPAREN);
      *end_tkn = tkn;
 
       if (is_sizeof && ty->kind == TY_VLA) {
@@ -2370,28 +2404,28 @@ static Node *unary(Token *tkn, Token **end_tkn) {
 static Node *postfix(Token *tkn, Token **end_tkn) {
   Node *node = primary(tkn, &tkn);
 
-  while (equal(tkn, "[") || equal(tkn, "(") || equal(tkn, "++") ||
-         equal(tkn, "--") || equal(tkn, ".") || equal(tkn, "->")) {
-    if (equal(tkn, "[")) {
-      node = new_unary(ND_CONTENT, tkn, new_add(tkn, node, assign(tkn->next, &tkn)));
-      tkn = skip(tkn, "]");
+  while (equal_id(tkn, PN_LBRACKET) || equal_id(tkn, PN_LPAREN) || equal_id(tkn, PN_INC) ||
+         equal_id(tkn, PN_DEC) || equal_id(tkn, PN_DOT) || equal_id(tkn, PN_ARROW)) {
+    if (equal_id(tkn, PN_LBRACKET)) {
+      node = new_unary(ND_CONTENT, tkn, new_add(tkn, node, assign(next_token(tkn), &tkn)));
+      tkn = skip_id(tkn, PN_RBRACKET);
       continue;
     }
 
-    if (equal(tkn, "(")) {
+    if (equal_id(tkn, PN_LPAREN)) {
       node = new_unary(ND_FUNCCALL, tkn, node);
       node->func = node->lhs->var;
       node->ty = node->lhs->var->ty;
       node->lhs = NULL;
-      tkn = tkn->next;
+      tkn = next_token(tkn);
 
       int argc = 0;
       Node head = {};
       Node *cur = &head;
 
-      while (!consume(tkn, &tkn, ")")) {
+      while (!consume_id(tkn, &tkn, PN_RPAREN)) {
         if (cur != &head) {
-          tkn = skip(tkn, ",");
+          tkn = skip_id(tkn, PN_COMMA);
         }
 
         cur->next = new_unary(ND_VOID, tkn, assign(tkn, &tkn));
@@ -2415,35 +2449,35 @@ static Node *postfix(Token *tkn, Token **end_tkn) {
       continue;
     }
 
-    if (equal(tkn, "++")) {
+    if (equal_id(tkn, PN_INC)) {
       node = to_assign(tkn, new_add(tkn, node, new_num(tkn, 1)));
       node->next = new_sub(tkn, node->lhs, new_num(tkn, 1));
       node = new_commma(tkn, node);
-      tkn = tkn->next;
+      tkn = next_token(tkn);
       continue;
     }
 
-    if (equal(tkn, "--")) {
+    if (equal_id(tkn, PN_DEC)) {
       node = to_assign(tkn, new_sub(tkn, node, new_num(tkn, 1)));
       node->next = new_add(tkn, node->lhs, new_num(tkn, 1));
       node = new_commma(tkn, node);
-      tkn = tkn->next;
+      tkn = next_token(tkn);
       continue;
     }
 
     // "." or "->" operator
     add_type(node);
 
-    if (equal(tkn, "->") && node->ty->kind != TY_PTR) {
+    if (equal_id(tkn, PN_ARROW) && node->ty->kind != TY_PTR) {
       errorf_tkn(ER_COMPILE, tkn, "Need pointer type");
     }
 
-    Type *ty = equal(tkn, ".") ? node->ty : node->ty->base;
+    Type *ty = equal_id(tkn, PN_DOT) ? node->ty : node->ty->base;
     if (!is_struct_type(ty)) {
       errorf_tkn(ER_COMPILE, tkn, "Need struct or union type");
     }
 
-    Member *member = find_member(ty->members, get_ident(tkn->next));
+    Member *member = find_member(ty->members, get_ident(next_token(tkn)));
     if (member == NULL) {
       errorf_tkn(ER_COMPILE, tkn, "This member is not found");
     }
@@ -2454,7 +2488,7 @@ static Node *postfix(Token *tkn, Token **end_tkn) {
     add_type(node);
 
     node->ty = member->ty;
-    tkn = tkn->next->next;
+    tkn = next_token(next_token(tkn));
   }
 
  *end_tkn = tkn;
@@ -2471,28 +2505,28 @@ static Node *postfix(Token *tkn, Token **end_tkn) {
 // gnu-statement-expr = "({" statement statement* "})"
 static Node *primary(Token *tkn, Token **end_tkn) {
   // GNU Statements
-  if (equal(tkn, "(") && equal(tkn->next, "{")) {
+  if (equal_id(tkn, PN_LPAREN) && equal_id(next_token(tkn), PN_LBRACE)) {
     enter_scope();
-    Node *ret = statement(tkn->next, &tkn);
+    Node *ret = statement(next_token(tkn), &tkn);
     leave_scope();
  
-    tkn = skip(tkn, ")");
+    tkn = skip_id(tkn, PN_RPAREN);
  
    *end_tkn = tkn;
     return ret;
   }
 
-  if (equal(tkn, "(")) {
-    Node *node = expr(tkn->next, &tkn);
+  if (equal_id(tkn, PN_LPAREN)) {
+    Node *node = expr(next_token(tkn), &tkn);
 
-    tkn = skip(tkn, ")");
+    tkn = skip_id(tkn, PN_RPAREN);
    *end_tkn = tkn;
     return node;
   }
 
   // identifier
   if (tkn->kind == TK_IDENT) {
-    Obj *obj = find_var(get_ident(tkn));
+    Obj *obj = find_var(get_atom(tkn));
 
     if (obj == NULL) {
       errorf_tkn(ER_COMPILE, tkn, "This object is not declaration.");
@@ -2501,12 +2535,12 @@ static Node *primary(Token *tkn, Token **end_tkn) {
     Node *node = new_var(tkn, obj);
     add_type(node);
 
-   *end_tkn = tkn->next;
+   *end_tkn = next_token(tkn);
     return node;
   }
 
   if (tkn->kind == TK_STR) {
-   *end_tkn = tkn->next;
+   *end_tkn = next_token(tkn);
     return new_strlit(tkn);
   }
 
@@ -2520,7 +2554,7 @@ static Node *constant(Token *tkn, Token **end_tkn) {
     errorf_tkn(ER_COMPILE, tkn, "Grammatical Error");
   }
 
-  Type *ty = tkn->ty;
+  Type *ty = tkn->lit->ty;
   Node *node = new_node(ND_NUM, tkn);
   node->ty = ty;
 
@@ -2528,12 +2562,12 @@ static Node *constant(Token *tkn, Token **end_tkn) {
     case TY_FLOAT:
     case TY_DOUBLE:
     case TY_LDOUBLE:
-      node = new_floating(tkn, ty, tkn->fval);
+      node = new_floating(tkn, ty, tkn->lit->fval);
       break;
     default:
-      node->val = tkn->val;
+      node->val = tkn->lit->val;
   }
 
- *end_tkn = tkn->next;
+ *end_tkn = next_token(tkn);
   return node;
 }
@@ -60,6 +60,9 @@ typedef enum {
   ND_INIT,        // Initializer
 } NodeKind;
 
+// The members of the payload share the memory in the slots, so that a node
+// is not as large as the sum of all members. The members of the same slot
+// are never used by the same kind of node.
 struct Node {
   NodeKind kind; // Node kind
   Token *tkn;    // Representative token
@@ -69,32 +72,39 @@ struct Node {
   Node *lhs;     // Left side node
   Node *rhs;     // Right side node
 
-  Node *deep;    // Block or statement
-
-  Obj *var; // Variable
-
-  Node *init;  // Initialization (variable, for statement)
-  Node *cond;  // condition (if, for, while)
-  Node *then;  // cond true statement
-  Node *other; // cond false statement
-  Node *loop;  // Loop statement
-
-  // Function call
-  Obj *func;
-  int argc;
-  Node *args;
-  bool pass_by_stack;
-
-  char *label;
-  char *break_label;
+  union {
+    Obj *var;    // Variable (ND_VAR), or label of the address (ND_NUM)
+    Node *cond;  // condition (if, for, while, switch, "?:")
+    Node *deep;  // Block or statement
+    Node *args;  // Arguments of function call
+  };
+
+  union {
+    int64_t val;        // Value if kind is ND_NUM or ND_CASE
+    Node *then;         // cond true statement
+    Obj *func;          // Function or called function
+    char *label;        // Label of goto or label statement
+    Node *default_stmt; // Default statement of switch
+  };
+
+  union {
+    long double fval; // Floating-value if kind is ND_NUM
+
+    struct {
+      union {
+        Node *init;      // Initialization (variable, for statement)
+        Node *other;     // cond false statement
+        Node *case_stmt; // Case statements of switch, or next case statement
+      };
+      Node *loop;        // Loop statement
+    };
+  };
+
+  union {
+    char *break_label;
+    bool pass_by_stack; // Argument of function call is passed by stack
+  };
   char *conti_label;
-
-  // swtich
-  Node *case_stmt;
-  Node *default_stmt;
-
-  int64_t val;        // Value if kind is ND_NUM
-  long double fval;   // Floating-value if kind is ND_NUM
 };
 
 char *new_unique_label();
@@ -103,6 +113,7 @@ Node *new_cast(Node *expr, Type *ty);
 Node *new_var(Token *tkn, Obj *obj);
 Node *last_stmt(Node *now);
 Node *program(Token *tkn);
+void print_ast_stats();
 
 //
 // object.c
@@ -134,6 +145,7 @@ struct Type {
 
   bool is_const;
   bool is_unsigned;
+  Type *qualified;  // Const qualified copy of the type
 
   // Declaration
   char *name;
@@ -188,6 +200,9 @@ Type *copy_type(Type *ty);
 void init_type();
 Type *pointer_to(Type *type);
 Type *array_to(Type *type, int array_len);
+Type *qualify_type(Type *ty, bool is_const);
+void complete_qualified_type(Type *ty);
+void print_type_stats();
 bool is_integer_type(Type *ty);
 bool is_float_type(Type *ty);
 bool is_struct_type(Type *ty);
@@ -227,12 +242,12 @@ Obj *new_obj(Type *type, char *name);
 void enter_scope();
 void leave_scope();
 void add_var(Obj *var, bool set_offset);
-void add_tag(Type *ty, char *name);
-void enforce_add_tag(Type *ty, char *name);
-void add_type_def(Type *ty, char *name);
-Obj *find_var(char *name);
-Type *find_tag(char *name);
-Type *find_type_def(char *name);
+void add_tag(Type *ty, Atom *name);
+void enforce_add_tag(Type *ty, Atom *name);
+void add_type_def(Type *ty, Atom *name);
+Obj *find_var(Atom *name);
+Type *find_tag(Atom *name);
+Type *find_type_def(Atom *name);
 Obj *find_obj(char *name);
 int init_offset();
 bool declare_func(Type *ty, bool is_static);
@@ -0,0 +1,252 @@
+// Builtin headers
+//
+// The freestanding headers which are provided by the compiler are embedded
+// in the binary, so that they are included without searching the include
+// paths or reading the files. They are for x86-64 Linux (LP64).
+
+#include "token/tokenize.h"
+#include "util/util.h"
+
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+  char *name;      // Name in the include directive
+  char *path;      // Name of the file in the diagnostics
+  char *contents;  // Contents which end with a newline
+} BuiltinHeader;
+
+static BuiltinHeader builtin_headers[] = {
+  {"stddef.h", "<builtin>/stddef.h",
+   "#ifndef __STDDEF_H\n"
+   "#define __STDDEF_H\n"
+   "\n"
+   "#define NULL ((void *)0)\n"
+   "\n"
+   "typedef unsigned long size_t;\n"
+   "typedef long ptrdiff_t;\n"
+   "typedef int wchar_t;\n"
+   "typedef long double max_align_t;\n"
+   "\n"
+   "#define offsetof(type, member) ((size_t)&(((type *)0)->member))\n"
+   "\n"
+   "#endif\n"},
+
+  // Variadic functions are not supported yet, so va_start and va_arg are not defined.
+  {"stdarg.h", "<builtin>/stdarg.h",
+   "#ifndef __STDARG_H\n"
+   "#define __STDARG_H\n"
+   "\n"
+   "typedef struct {\n"
+   "  unsigned int gp_offset;\n"
+   "  unsigned int fp_offset;\n"
+   "  void *overflow_arg_area;\n"
+   "  void *reg_save_area;\n"
+   "} __va_elem;\n"
+   "\n"
+   "typedef __va_elem va_list[1];\n"
+   "typedef va_list __gnuc_va_list;\n"
+   "\n"
+   "#define va_end(ap) ((void)(ap))\n"
+   "#define va_copy(dest, src) (*(dest) = *(src))\n"
+   "\n"
+   "#endif\n"},
+
+  {"stdbool.h", "<builtin>/stdbool.h",
+   "#ifndef __STDBOOL_H\n"
+   "#define __STDBOOL_H\n"
+   "\n"
+   "#define bool _Bool\n"
+   "#define true 1\n"
+   "#define false 0\n"
+   "#define __bool_true_false_are_defined 1\n"
+   "\n"
+   "#endif\n"},
+
+  {"stdint.h", "<builtin>/stdint.h",
+   "#ifndef __STDINT_H\n"
+   "#define __STDINT_H\n"
+   "\n"
+   "typedef signed char int8_t;\n"
+   "typedef short int16_t;\n"
+   "typedef int int32_t;\n"
+   "typedef long int64_t;\n"
+   "typedef unsigned char uint8_t;\n"
+   "typedef unsigned short uint16_t;\n"
+   "typedef unsigned int uint32_t;\n"
+   "typedef unsigned long uint64_t;\n"
+   "\n"
+   "typedef signed char int_least8_t;\n"
+   "typedef short int_least16_t;\n"
+   "typedef int int_least32_t;\n"
+   "typedef long int_least64_t;\n"
+   "typedef unsigned char uint_least8_t;\n"
+   "typedef unsigned short uint_least16_t;\n"
+   "typedef unsigned int uint_least32_t;\n"
+   "typedef unsigned long uint_least64_t;\n"
+   "\n"
+   "typedef signed char int_fast8_t;\n"
+   "typedef long int_fast16_t;\n"
+   "typedef long int_fast32_t;\n"
+   "typedef long int_fast64_t;\n"
+   "typedef unsigned char uint_fast8_t;\n"
+   "typedef unsigned long uint_fast16_t;\n"
+   "typedef unsigned long uint_fast32_t;\n"
+   "typedef unsigned long uint_fast64_t;\n"
+   "\n"
+   "typedef long intptr_t;\n"
+   "typedef unsigned long uintptr_t;\n"
+   "typedef long intmax_t;\n"
+   "typedef unsigned long uintmax_t;\n"
+   "\n"
+   "#define INT8_MIN (-128)\n"
+   "#define INT16_MIN (-32767 - 1)\n"
+   "#define INT32_MIN (-2147483647 - 1)\n"
+   "#define INT64_MIN (-9223372036854775807L - 1)\n"
+   "#define INT8_MAX 127\n"
+   "#define INT16_MAX 32767\n"
+   "#define INT32_MAX 2147483647\n"
+   "#define INT64_MAX 9223372036854775807L\n"
+   "#define UINT8_MAX 255\n"
+   "#define UINT16_MAX 65535\n"
+   "#define UINT32_MAX 4294967295U\n"
+   "#define UINT64_MAX 18446744073709551615UL\n"
+   "\n"
+   "#define INT_LEAST8_MIN INT8_MIN\n"
+   "#define INT_LEAST16_MIN INT16_MIN\n"
+   "#define INT_LEAST32_MIN INT32_MIN\n"
+   "#define INT_LEAST64_MIN INT64_MIN\n"
+   "#define INT_LEAST8_MAX INT8_MAX\n"
+   "#define INT_LEAST16_MAX INT16_MAX\n"
+   "#define INT_LEAST32_MAX INT32_MAX\n"
+   "#define INT_LEAST64_MAX INT64_MAX\n"
+   "#define UINT_LEAST8_MAX UINT8_MAX\n"
+   "#define UINT_LEAST16_MAX UINT16_MAX\n"
+   "#define UINT_LEAST32_MAX UINT32_MAX\n"
+   "#define UINT_LEAST64_MAX UINT64_MAX\n"
+   "\n"
+   "#define INT_FAST8_MIN INT8_MIN\n"
+   "#define INT_FAST16_MIN INT64_MIN\n"
+   "#define INT_FAST32_MIN INT64_MIN\n"
+   "#define INT_FAST64_MIN INT64_MIN\n"
+   "#define INT_FAST8_MAX INT8_MAX\n"
+   "#define INT_FAST16_MAX INT64_MAX\n"
+   "#define INT_FAST32_MAX INT64_MAX\n"
+   "#define INT_FAST64_MAX INT64_MAX\n"
+   "#define UINT_FAST8_MAX UINT8_MAX\n"
+   "#define UINT_FAST16_MAX UINT64_MAX\n"
+   "#define UINT_FAST32_MAX UINT64_MAX\n"
+   "#define UINT_FAST64_MAX UINT64_MAX\n"
+   "\n"
+   "#define INTPTR_MIN INT64_MIN\n"
+   "#define INTPTR_MAX INT64_MAX\n"
+   "#define UINTPTR_MAX UINT64_MAX\n"
+   "#define INTMAX_MIN INT64_MIN\n"
+   "#define INTMAX_MAX INT64_MAX\n"
+   "#define UINTMAX_MAX UINT64_MAX\n"
+   "#define PTRDIFF_MIN INT64_MIN\n"
+   "#define PTRDIFF_MAX INT64_MAX\n"
+   "#define SIZE_MAX UINT64_MAX\n"
+   "\n"
+   "#define INT8_C(c) c\n"
+   "#define INT16_C(c) c\n"
+   "#define INT32_C(c) c\n"
+   "#define INT64_C(c) c ## L\n"
+   "#define UINT8_C(c) c\n"
+   "#define UINT16_C(c) c\n"
+   "#define UINT32_C(c) c ## U\n"
+   "#define UINT64_C(c) c ## UL\n"
+   "#define INTMAX_C(c) c ## L\n"
+   "#define UINTMAX_C(c) c ## UL\n"
+   "\n"
+   "#endif\n"},
+
+  {"limits.h", "<builtin>/limits.h",
+   "#ifndef __LIMITS_H\n"
+   "#define __LIMITS_H\n"
+   "\n"
+   "#define CHAR_BIT 8\n"
+   "#define MB_LEN_MAX 16\n"
+   "\n"
+   "#define SCHAR_MIN (-128)\n"
+   "#define SCHAR_MAX 127\n"
+   "#define UCHAR_MAX 255\n"
+   "#define CHAR_MIN SCHAR_MIN\n"
+   "#define CHAR_MAX SCHAR_MAX\n"
+   "\n"
+   "#define SHRT_MIN (-32767 - 1)\n"
+   "#define SHRT_MAX 32767\n"
+   "#define USHRT_MAX 65535\n"
+   "#define INT_MIN (-2147483647 - 1)\n"
+   "#define INT_MAX 2147483647\n"
+   "#define UINT_MAX 4294967295U\n"
+   "#define LONG_MIN (-9223372036854775807L - 1)\n"
+   "#define LONG_MAX 9223372036854775807L\n"
+   "#define ULONG_MAX 18446744073709551615UL\n"
+   "#define LLONG_MIN (-9223372036854775807LL - 1)\n"
+   "#define LLONG_MAX 9223372036854775807LL\n"
+   "#define ULLONG_MAX 18446744073709551615ULL\n"
+   "\n"
+   "#endif\n"},
+
+  {"float.h", "<builtin>/float.h",
+   "#ifndef __FLOAT_H\n"
+   "#define __FLOAT_H\n"
+   "\n"
+   "#define FLT_RADIX 2\n"
+   "#define FLT_ROUNDS 1\n"
+   "#define FLT_EVAL_METHOD 0\n"
+   "#define DECIMAL_DIG 21\n"
+   "\n"
+   "#define FLT_MANT_DIG 24\n"
+   "#define FLT_DIG 6\n"
+   "#define FLT_MIN_EXP (-125)\n"
+   "#define FLT_MIN_10_EXP (-37)\n"
+   "#define FLT_MAX_EXP 128\n"
+   "#define FLT_MAX_10_EXP 38\n"
+   "#define FLT_MAX 3.40282347e+38F\n"
+   "#define FLT_EPSILON 1.19209290e-7F\n"
+   "#define FLT_MIN 1.17549435e-38F\n"
+   "\n"
+   "#define DBL_MANT_DIG 53\n"
+   "#define DBL_DIG 15\n"
+   "#define DBL_MIN_EXP (-1021)\n"
+   "#define DBL_MIN_10_EXP (-307)\n"
+   "#define DBL_MAX_EXP 1024\n"
+   "#define DBL_MAX_10_EXP 308\n"
+   "#define DBL_MAX 1.7976931348623157e+308\n"
+   "#define DBL_EPSILON 2.2204460492503131e-16\n"
+   "#define DBL_MIN 2.2250738585072014e-308\n"
+   "\n"
+   "#define LDBL_MANT_DIG 64\n"
+   "#define LDBL_DIG 18\n"
+   "#define LDBL_MIN_EXP (-16381)\n"
+   "#define LDBL_MIN_10_EXP (-4931)\n"
+   "#define LDBL_MAX_EXP 16384\n"
+   "#define LDBL_MAX_10_EXP 4932\n"
+   "#define LDBL_MAX 1.18973149535723176502e+4932L\n"
+   "#define LDBL_EPSILON 1.08420217248550443401e-19L\n"
+   "#define LDBL_MIN 3.36210314311209350626e-4932L\n"
+   "\n"
+   "#endif\n"},
+};
+
+// Return the path of the builtin header, or NULL if there is no such header.
+char *find_builtin_header(char *name) {
+  for (size_t i = 0; i < sizeof(builtin_headers) / sizeof(*builtin_headers); i++) {
+    if (strcmp(builtin_headers[i].name, name) == 0) {
+      return builtin_headers[i].path;
+    }
+  }
+  return NULL;
+}
+
+// Return the builtin header of the path, or NULL if the path is not a builtin header.
+File *open_builtin_header(char *path) {
+  for (size_t i = 0; i < sizeof(builtin_headers) / sizeof(*builtin_headers); i++) {
+    if (strcmp(builtin_headers[i].path, path) == 0) {
+      return new_file(path, builtin_headers[i].contents);
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,213 @@
+// Output of the preprocessed tokens for "-E" option,
+// and the dependencies for "-M" options.
+//
+// The tokens are written through a large buffer, and the file is written
+// with a few system calls. Linemarkers such as '# 12 "foo.c"' are written
+// when the output moves to another file or skips many lines, so that the
+// output can be compiled with the same diagnostics as the source.
+
+#include "token/tokenize.h"
+#include "util/util.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OUTPUT_BUF_SIZE (1 << 20)
+
+// Blank lines are written instead of a linemarker
+// if the next line is at most this number of lines ahead.
+#define MAX_BLANK_LINES 8
+
+typedef struct {
+  int fd;
+  char *buf;
+  int len;
+} Writer;
+
+static void writer_flush(Writer *w) {
+  for (int offset = 0; offset < w->len;) {
+    ssize_t written = write(w->fd, w->buf + offset, w->len - offset);
+    if (written < 0) {
+      errorf(ER_INTERNAL, "Failed to write the preprocessed output");
+    }
+    offset += written;
+  }
+  w->len = 0;
+}
+
+// The writer writes to stdout if path is NULL.
+static void writer_open(Writer *w, char *path) {
+  w->fd = STDOUT_FILENO;
+  w->buf = calloc(OUTPUT_BUF_SIZE, sizeof(char));
+  w->len = 0;
+  if (path != NULL && (w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+    errorf(ER_INTERNAL, "Failed to open the file: %s", path);
+  }
+}
+
+static void writer_write(Writer *w, char *str, int len) {
+  if (w->len + len > OUTPUT_BUF_SIZE) {
+    writer_flush(w);
+  }
+
+  // A token longer than the buffer is written directly.
+  if (len > OUTPUT_BUF_SIZE) {
+    Writer direct = {w->fd, str, len};
+    writer_flush(&direct);
+    return;
+  }
+
+  memcpy(w->buf + w->len, str, len);
+  w->len += len;
+}
+
+static void writer_putc(Writer *w, char c) {
+  writer_write(w, &c, 1);
+}
+
+static void writer_close(Writer *w) {
+  writer_flush(w);
+  if (w->fd != STDOUT_FILENO) {
+    close(w->fd);
+  }
+  free(w->buf);
+}
+
+static void write_linemarker(Writer *w, int line_no, File *file) {
+  char str[64];
+  int len = snprintf(str, sizeof(str), "# %d \"", line_no);
+  writer_write(w, str, len);
+  writer_write(w, file->name, strlen(file->name));
+  writer_write(w, "\"\n", 2);
+}
+
+// Return the token in the source where tkn comes from.
+// All tokens of the same macro expansion have the same origin.
+static Token *origin_token(Token *tkn) {
+  while (tkn->ref_tkn != NULL) {
+    tkn = tkn->ref_tkn;
+  }
+  return tkn;
+}
+
+static bool is_word(Token *tkn) {
+  return tkn->kind == TK_IDENT || tkn->kind == TK_KEYWORD || tkn->kind == TK_NUM;
+}
+
+// Tokens which were not adjacent in the source, such as the tokens of
+// a macro expansion, are separated if they would be read as other tokens.
+static bool need_space(Token *prev, Token *tkn) {
+  if (prev == NULL || (prev->ref_tkn == NULL && tkn->ref_tkn == NULL)) {
+    return false;
+  }
+
+  // The tokens which are adjacent in the source are read as the same tokens.
+  if (prev->file == tkn->file && prev->loc + prev->len == tkn->loc) {
+    return false;
+  }
+
+  if (is_word(prev) && is_word(tkn)) {
+    return true;
+  }
+
+  // A numerical literal continues with "." and the sign of the exponent.
+  if (prev->kind == TK_NUM && tkn->kind == TK_PUNCT) {
+    char c = prev->loc[prev->len - 1];
+    return equal_id(tkn, PN_DOT) || ((equal_id(tkn, PN_ADD) || equal_id(tkn, PN_SUB)) && strchr("eEpP", c) != NULL);
+  }
+  if (prev->kind == TK_PUNCT && tkn->kind == TK_NUM) {
+    return equal_id(prev, PN_DOT);
+  }
+
+  return prev->kind == TK_PUNCT && tkn->kind == TK_PUNCT && is_joined_punct(prev, tkn);
+}
+
+// Write the preprocessed tokens to the file, or stdout if path is NULL.
+void output_preprocessed(Token *tkn, char *path, bool has_linemarker) {
+  Writer w;
+  writer_open(&w, path);
+
+  File *cur_file = NULL;
+  int cur_line = 0;
+  Token *prev = NULL, *prev_origin = NULL;
+
+  for (; tkn != NULL && !is_eof(tkn); tkn = next_token(tkn)) {
+    Token *origin = origin_token(tkn);
+
+    // A line of the output begins when the token comes from another line in the source,
+    // even if the first token of the line expands to nothing.
+    // The tokens of a macro expansion stay on the line of the macro name.
+    // A file which is included again begins a line even if its line number does not change,
+    // which is known by the first token of a line appearing after the other tokens.
+    int line_no = cur_line;
+    bool is_new_line = false;
+    if (origin != prev_origin) {
+      line_no = get_line_no(origin->file, get_orig_loc(origin->file, origin->loc));
+      is_new_line = line_no != cur_line || origin->at_bol;
+    }
+
+    if (prev == NULL || origin->file != cur_file || is_new_line) {
+      if (origin->file != cur_file || line_no <= cur_line || line_no > cur_line + MAX_BLANK_LINES) {
+        if (prev != NULL) {
+          writer_putc(&w, '\n');
+        }
+        if (has_linemarker) {
+          write_linemarker(&w, line_no, origin->file);
+        }
+      } else {
+        for (int i = cur_line; i < line_no; i++) {
+          writer_putc(&w, '\n');
+        }
+      }
+      cur_file = origin->file;
+      cur_line = line_no;
+    } else if (tkn->has_space || need_space(prev, tkn)) {
+      writer_putc(&w, ' ');
+    }
+
+    writer_write(&w, tkn->loc, tkn->len);
+    prev = tkn;
+    prev_origin = origin;
+  }
+
+  writer_putc(&w, '\n');
+  writer_close(&w);
+}
+
+// Spaces and '#' are escaped with a backslash, and '$' is doubled for make.
+static void write_make_path(Writer *w, char *path) {
+  for (char *c = path; *c != '\0'; c++) {
+    if (*c == ' ' || *c == '#') {
+      writer_putc(w, '\\');
+    } else if (*c == '$') {
+      writer_putc(w, '$');
+    }
+    writer_putc(w, *c);
+  }
+}
+
+// Write the make rule of the target which depends on the input file
+// and the included files. The system headers are omitted unless has_system is true.
+void output_dependencies(char *path, char *target, char *input_file, bool has_system) {
+  Writer w;
+  writer_open(&w, path);
+
+  write_make_path(&w, target);
+  writer_write(&w, ": ", 2);
+  write_make_path(&w, input_file);
+
+  for (Dependency *dep = dependencies; dep != NULL; dep = dep->next) {
+    if (dep->is_system && !has_system) {
+      continue;
+    }
+    writer_write(&w, " \\\n  ", 5);
+    write_make_path(&w, dep->path);
+  }
+
+  writer_putc(&w, '\n');
+  writer_close(&w);
+}
@@ -0,0 +1,584 @@
+// Precompiled header
+//
+// The macro table, the include guards and the preprocessed tokens of a header
+// are saved in a binary file, so that the header is not tokenized and
+// preprocessed again. The file is loaded with mmap, and the contents of
+// the source files and the strings in it are referred to without copy.
+
+#include "parser/parser.h"
+#include "token/tokenize.h"
+#include "util/util.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PCH_MAGIC "JCCPCH\0\0"
+#define PCH_VERSION 4
+
+// The offsets in the header are relative to the beginning of the file,
+// and the other offsets are relative to the data section after the header.
+// All indexes are -1 if there is no item.
+typedef struct {
+  char magic[8];
+  int32_t version;
+  int32_t file_cnt;
+  int32_t tkn_cnt;
+  int32_t lit_cnt;
+  int32_t macro_cnt;
+  int32_t arg_cnt;
+  int32_t inc_cnt;
+  int32_t head;  // Index of the first preprocessed token
+
+  int64_t file_offset;
+  int64_t tkn_offset;
+  int64_t macro_offset;
+  int64_t arg_offset;
+  int64_t inc_offset;
+} PchHeader;
+
+typedef struct {
+  int64_t name;
+  int64_t contents;
+  int64_t orig_contents;
+  int64_t splice_offset;
+  int64_t splice_shift;
+  int32_t splice_cnt;
+  int64_t mtime;  // Modification time of the source file in nanoseconds, or 0
+} PchFile;
+
+// The loc is the offset in the file contents if is_file_loc is true,
+// otherwise it is the offset of the copied string.
+typedef struct {
+  int32_t kind;
+  int32_t id;
+  int32_t at_bol;
+  int32_t has_space;
+  int32_t next;
+  int32_t ref_tkn;
+  int32_t file;
+  int32_t is_file_loc;
+  int32_t has_lit;
+  int64_t loc;
+  int32_t len;
+  int32_t ty;         // Index of pch_types, or TY_STRLIT
+  int32_t array_len;  // Array length if ty is TY_STRLIT
+  int64_t strlit;
+  int64_t val;
+  long double fval;
+} PchToken;
+
+typedef struct {
+  int64_t name;
+  int32_t is_objlike;
+  int32_t expand_tkn;
+  int32_t arg;  // Index of the first argument name
+  int32_t arg_cnt;
+} PchMacro;
+
+typedef struct {
+  int64_t path;
+  int64_t guard;  // Offset of the guard name, or -1
+  int32_t is_once;
+} PchInclude;
+
+// Types of numeric literals are saved as the index of this array.
+// String literals are always arrays of char.
+#define TY_STRLIT -1
+static Type **pch_types[] = {
+  &ty_i8, &ty_i32, &ty_i64, &ty_u32, &ty_u64, &ty_f32, &ty_f64, &ty_f80,
+};
+#define PCH_TYPE_CNT ((int)(sizeof(pch_types) / sizeof(*pch_types)))
+
+//
+// Emit
+//
+
+typedef struct {
+  char *buf;
+  int64_t len;
+  int64_t capacity;
+} Buffer;
+
+// Items are stored in the separate buffers
+// and concatenated into the file at the end.
+static Buffer files, tkns, pch_macros, args, incs, data;
+static HashMap file_idx, tkn_idx;  // Index + 1 of the saved files and tokens
+static int lit_cnt;
+static int64_t *file_len;
+
+static int64_t buffer_add(Buffer *buf, void *item, int64_t size) {
+  if (buf->len + size > buf->capacity) {
+    buf->capacity = (buf->len + size) * 2;
+    buf->buf = realloc(buf->buf, buf->capacity);
+  }
+
+  int64_t offset = buf->len;
+  if (item != NULL) {
+    memcpy(buf->buf + offset, item, size);
+  } else {
+    memset(buf->buf + offset, 0, size);
+  }
+  buf->len += size;
+  return offset;
+}
+
+// Data is aligned, since it is referred to without copy.
+static int64_t add_data(void *item, int64_t size) {
+  int64_t padding = ((data.len + 15) & ~15) - data.len;
+  buffer_add(&data, NULL, padding);
+  return buffer_add(&data, item, size);
+}
+
+static int64_t add_str(char *str, int len) {
+  int64_t offset = add_data(str, len + 1);
+  data.buf[offset + len] = '\0';
+  return offset;
+}
+
+static int32_t add_file(File *file) {
+  if (file == NULL) {
+    return -1;
+  }
+
+  int32_t idx = (intptr_t)hashmap_pget(&file_idx, file) - 1;
+  if (idx >= 0) {
+    return idx;
+  }
+
+  PchFile pfile = {};
+  pfile.name = add_str(file->name, strlen(file->name));
+  pfile.contents = add_str(file->contents, strlen(file->contents));
+  pfile.orig_contents = pfile.contents;
+  if (file->orig_contents != file->contents) {
+    pfile.orig_contents = add_str(file->orig_contents, strlen(file->orig_contents));
+  }
+  pfile.splice_cnt = file->splice_cnt;
+  pfile.splice_offset = add_data(file->splice_offset, sizeof(int) * file->splice_cnt);
+  pfile.splice_shift = add_data(file->splice_shift, sizeof(int) * file->splice_cnt);
+  pfile.mtime = file->mtime;
+
+  idx = files.len / sizeof(PchFile);
+  buffer_add(&files, &pfile, sizeof(PchFile));
+
+  file_len = realloc(file_len, sizeof(int64_t) * (idx + 1));
+  file_len[idx] = strlen(file->contents);
+  hashmap_pinsert(&file_idx, file, (void *)(intptr_t)(idx + 1));
+  return idx;
+}
+
+static int32_t get_type_idx(Token *tkn) {
+  if ((tkn->kind != TK_NUM && tkn->kind != TK_STR) || tkn->lit == NULL || tkn->lit->ty == NULL) {
+    return 0;
+  }
+
+  if (tkn->kind == TK_STR) {
+    return TY_STRLIT;
+  }
+
+  for (int i = 0; i < PCH_TYPE_CNT; i++) {
+    if (*pch_types[i] == tkn->lit->ty) {
+      return i + 1;
+    }
+  }
+  errorf_tkn(ER_INTERNAL, tkn, "Cannot save the type of this token");
+  return 0;
+}
+
+static int32_t add_ref_token(Token *tkn);
+
+static void set_token(int32_t idx, Token *tkn, int32_t next) {
+  PchToken ptkn = {};
+  ptkn.kind = tkn->kind;
+  ptkn.id = tkn->id;
+  ptkn.at_bol = tkn->at_bol;
+  ptkn.has_space = tkn->has_space;
+  ptkn.next = next;
+  ptkn.ref_tkn = add_ref_token(tkn->ref_tkn);
+  ptkn.file = add_file(tkn->file);
+  ptkn.len = tkn->len;
+  ptkn.ty = get_type_idx(tkn);
+  ptkn.strlit = -1;
+  if ((tkn->kind == TK_NUM || tkn->kind == TK_STR) && tkn->lit != NULL) {
+    lit_cnt++;
+    ptkn.has_lit = true;
+    ptkn.val = tkn->lit->val;
+    ptkn.fval = tkn->lit->fval;
+  }
+
+  if (ptkn.file >= 0 && tkn->file->contents <= tkn->loc &&
+      tkn->loc + tkn->len <= tkn->file->contents + file_len[ptkn.file]) {
+    ptkn.is_file_loc = true;
+    ptkn.loc = tkn->loc - tkn->file->contents;
+  } else {
+    ptkn.loc = add_str(tkn->loc, tkn->len);
+  }
+
+  if (ptkn.ty == TY_STRLIT) {
+    Type *ty = tkn->lit->ty;
+    ptkn.array_len = ty->array_len;
+    ptkn.strlit = add_data(tkn->lit->strlit, ty->array_len);
+  }
+
+  memcpy(tkns.buf + idx * sizeof(PchToken), &ptkn, sizeof(PchToken));
+}
+
+// Add the token which is referred to by other tokens.
+// It is saved once, and the tokens which refer to it share it.
+// If it is not saved yet, it is not linked to others.
+static int32_t add_ref_token(Token *tkn) {
+  if (tkn == NULL) {
+    return -1;
+  }
+
+  int32_t idx = (intptr_t)hashmap_pget(&tkn_idx, tkn) - 1;
+  if (idx >= 0) {
+    return idx;
+  }
+
+  idx = tkns.len / sizeof(PchToken);
+  buffer_add(&tkns, NULL, sizeof(PchToken));
+  hashmap_pinsert(&tkn_idx, tkn, (void *)(intptr_t)(idx + 1));
+  set_token(idx, tkn, -1);
+  return idx;
+}
+
+// Add the token list, and the tokens are placed in a row.
+static int32_t add_token_list(Token *tkn, Token *end) {
+  if (tkn == end) {
+    return -1;
+  }
+
+  int32_t head = tkns.len / sizeof(PchToken);
+  int cnt = 0;
+  for (Token *cur = tkn; cur != end; cur = cur->next) {
+    buffer_add(&tkns, NULL, sizeof(PchToken));
+    if (hashmap_pget(&tkn_idx, cur) == NULL) {
+      hashmap_pinsert(&tkn_idx, cur, (void *)(intptr_t)(head + cnt + 1));
+    }
+    cnt++;
+  }
+
+  for (int i = 0; i < cnt; i++, tkn = tkn->next) {
+    set_token(head + i, tkn, i + 1 < cnt ? head + i + 1 : -1);
+  }
+  return head;
+}
+
+static void add_macro_item(char *key, int keylen, void *item) {
+  Macro *macro = item;
+
+  // The handler macros are predefined when the header is loaded.
+  if (macro->handler != NULL) {
+    return;
+  }
+
+  PchMacro pmacro = {};
+  pmacro.name = add_str(key, keylen);
+  pmacro.is_objlike = macro->is_objlike;
+  pmacro.expand_tkn = add_token_list(macro->expand_tkn, NULL);
+  pmacro.arg = args.len / sizeof(int64_t);
+
+  for (MacroArg *arg = macro->args; arg != NULL; arg = arg->next) {
+    int64_t name = add_str(arg->name, strlen(arg->name));
+    buffer_add(&args, &name, sizeof(int64_t));
+    pmacro.arg_cnt++;
+  }
+  buffer_add(&pch_macros, &pmacro, sizeof(PchMacro));
+}
+
+static void add_include_item(char *key, int keylen, void *item) {
+  IncludeFile *inc = item;
+
+  PchInclude pinc = {};
+  pinc.path = add_str(key, keylen);
+  pinc.guard = inc->guard != NULL ? add_str(inc->guard, strlen(inc->guard)) : -1;
+  pinc.is_once = inc->is_once;
+  buffer_add(&incs, &pinc, sizeof(PchInclude));
+}
+
+static int64_t write_section(FILE *fp, int64_t offset, Buffer *buf) {
+  static char pad[16];
+  int64_t aligned = (offset + 15) & ~15;
+  fwrite(pad, 1, aligned - offset, fp);
+  fwrite(buf->buf, 1, buf->len, fp);
+  return aligned;
+}
+
+void emit_pch(char *path, char *pch_path) {
+  // The header is included from a builtin file,
+  // so that its include guard is recorded as the other included files.
+  char *str = calloc(strlen(path) + 16, sizeof(char));
+  sprintf(str, "#include \"%s\"\n", path);
+
+  init_macro();
+  Token *tkn = tokenize_file(new_file("builtin", str));
+  add_eof_token(tkn);
+  tkn = preprocess(tkn);
+
+  // The end of file token is added when the header is loaded.
+  Token *eof = tkn;
+  while (!is_eof(eof)) {
+    eof = eof->next;
+  }
+
+  PchHeader header = {};
+  memcpy(header.magic, PCH_MAGIC, sizeof(header.magic));
+  header.version = PCH_VERSION;
+  header.head = add_token_list(tkn, eof);
+  hashmap_foreach(&macros, add_macro_item);
+  hashmap_foreach(&include_files, add_include_item);
+
+  header.file_cnt = files.len / sizeof(PchFile);
+  header.tkn_cnt = tkns.len / sizeof(PchToken);
+  header.lit_cnt = lit_cnt;
+  header.macro_cnt = pch_macros.len / sizeof(PchMacro);
+  header.arg_cnt = args.len / sizeof(int64_t);
+  header.inc_cnt = incs.len / sizeof(PchInclude);
+
+  FILE *fp = fopen(pch_path, "wb");
+  if (fp == NULL) {
+    errorf(ER_COMPILE, "Cannot open %s", pch_path);
+  }
+
+  // The header is written again when the offsets are fixed.
+  fwrite(&header, sizeof(header), 1, fp);
+  int64_t offset = write_section(fp, sizeof(header), &data) + data.len;
+  header.file_offset = write_section(fp, offset, &files);
+  header.tkn_offset = write_section(fp, header.file_offset + files.len, &tkns);
+  header.macro_offset = write_section(fp, header.tkn_offset + tkns.len, &pch_macros);
+  header.arg_offset = write_section(fp, header.macro_offset + pch_macros.len, &args);
+  header.inc_offset = write_section(fp, header.arg_offset + args.len, &incs);
+
+  fseek(fp, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, fp);
+  fclose(fp);
+}
+
+//
+// Load
+//
+
+// The loaded file is checked before it is used,
+// so that a broken file is reported instead of crashing the compiler.
+static char *pch_name;
+static char *pch_base;
+static int64_t pch_size;
+static char *pch_data;
+static int64_t pch_data_size;
+
+static void broken_pch() {
+  errorf(ER_COMPILE, "%s is broken", pch_name);
+}
+
+static bool in_range(int64_t offset, int64_t size, int64_t limit) {
+  return 0 <= offset && offset <= limit && 0 <= size && size <= limit - offset;
+}
+
+// Return the section of cnt items from the offset of the file.
+static void *get_section(int64_t offset, int32_t cnt, int64_t size) {
+  if (offset % 16 != 0 || cnt < 0 || !in_range(offset, cnt * size, pch_size)) {
+    broken_pch();
+  }
+  return pch_base + offset;
+}
+
+static void *get_data(int64_t offset, int64_t size) {
+  if (!in_range(offset, size, pch_data_size)) {
+    broken_pch();
+  }
+  return pch_data + offset;
+}
+
+// The string must be terminated in the data section.
+static char *get_data_str(int64_t offset) {
+  char *str = get_data(offset, 0);
+  if (memchr(str, '\0', pch_data_size - offset) == NULL) {
+    broken_pch();
+  }
+  return str;
+}
+
+// Return the item of the index, or NULL if the index is -1.
+static void *get_item(void *items, int32_t idx, int32_t cnt, int64_t size) {
+  if (idx < -1 || idx >= cnt) {
+    broken_pch();
+  }
+  return idx >= 0 ? (char *)items + idx * size : NULL;
+}
+
+// The precompiled header is stale if a source file has been modified since it was made.
+static void check_mtime(File *file, int64_t mtime) {
+  struct stat st;
+  if (mtime != 0 && stat(file->name, &st) == 0 &&
+      st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec != mtime) {
+    errorf(ER_COMPILE, "%s has been modified since %s was made", file->name, pch_name);
+  }
+}
+
+Token *load_pch(char *pch_path) {
+  int fd = open(pch_path, O_RDONLY);
+  struct stat st;
+  if (fd == -1 || fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(PchHeader)) {
+    errorf(ER_COMPILE, "Cannot open %s", pch_path);
+  }
+
+  // The mapping is private, so that tokens can be rewritten by copy-on-write.
+  char *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    errorf(ER_COMPILE, "Cannot open %s", pch_path);
+  }
+
+  PchHeader *header = (PchHeader *)base;
+  if (memcmp(header->magic, PCH_MAGIC, sizeof(header->magic)) != 0) {
+    errorf(ER_COMPILE, "%s is not a precompiled header", pch_path);
+  }
+  if (header->version != PCH_VERSION) {
+    errorf(ER_COMPILE, "%s is made by another version of jcc", pch_path);
+  }
+
+  // The data section follows the header.
+  pch_name = pch_path;
+  pch_base = base;
+  pch_size = st.st_size;
+  pch_data = base + ((sizeof(PchHeader) + 15) & ~15);
+  pch_data_size = pch_size - (pch_data - base);
+
+  PchFile *pfiles = get_section(header->file_offset, header->file_cnt, sizeof(PchFile));
+  File *files = calloc(header->file_cnt, sizeof(File));
+  int64_t *file_len = calloc(header->file_cnt, sizeof(int64_t));
+  for (int i = 0; i < header->file_cnt; i++) {
+    PchFile *pfile = &pfiles[i];
+    if (pfile->splice_cnt < 0) {
+      broken_pch();
+    }
+
+    files[i].name = get_data_str(pfile->name);
+    files[i].contents = get_data_str(pfile->contents);
+    files[i].orig_contents = get_data_str(pfile->orig_contents);
+    files[i].splice_cnt = pfile->splice_cnt;
+    files[i].splice_offset = get_data(pfile->splice_offset, sizeof(int) * pfile->splice_cnt);
+    files[i].splice_shift = get_data(pfile->splice_shift, sizeof(int) * pfile->splice_cnt);
+    files[i].mtime = pfile->mtime;
+    file_len[i] = strlen(files[i].contents);
+    check_mtime(&files[i], pfile->mtime);
+  }
+
+  int32_t tkn_cnt = header->tkn_cnt;
+  PchToken *ptkns = get_section(header->tkn_offset, tkn_cnt, sizeof(PchToken));
+  if (header->lit_cnt < 0 || header->lit_cnt > tkn_cnt) {
+    broken_pch();
+  }
+  Token *tkns = calloc(tkn_cnt, sizeof(Token));
+  TokenLiteral *lits = calloc(header->lit_cnt, sizeof(TokenLiteral));
+  int lit_idx = 0;
+  for (int i = 0; i < tkn_cnt; i++) {
+    PchToken *ptkn = &ptkns[i];
+    Token *tkn = &tkns[i];
+
+    // The tokens of a list are placed in a row.
+    if (ptkn->kind < TK_NUM || ptkn->kind > TK_EOF || ptkn->id < ID_NONE || ptkn->id >= ID_END ||
+        (ptkn->next != -1 && ptkn->next != i + 1) || ptkn->len < 0) {
+      broken_pch();
+    }
+
+    tkn->kind = ptkn->kind;
+    tkn->id = ptkn->id;
+    tkn->at_bol = ptkn->at_bol;
+    tkn->has_space = ptkn->has_space;
+    tkn->next = get_item(tkns, ptkn->next, tkn_cnt, sizeof(Token));
+    tkn->ref_tkn = get_item(tkns, ptkn->ref_tkn, tkn_cnt, sizeof(Token));
+    tkn->file = get_item(files, ptkn->file, header->file_cnt, sizeof(File));
+    if (ptkn->is_file_loc) {
+      if (tkn->file == NULL || !in_range(ptkn->loc, ptkn->len, file_len[ptkn->file])) {
+        broken_pch();
+      }
+      tkn->loc = tkn->file->contents + ptkn->loc;
+    } else {
+      tkn->loc = get_data(ptkn->loc, ptkn->len);
+    }
+    tkn->len = ptkn->len;
+
+    if (tkn->kind == TK_IDENT) {
+      tkn->atom = intern_atom(tkn->loc, tkn->len);
+    }
+
+    if (!ptkn->has_lit) {
+      continue;
+    }
+
+    if (lit_idx >= header->lit_cnt) {
+      broken_pch();
+    }
+    TokenLiteral *lit = &lits[lit_idx++];
+    lit->val = ptkn->val;
+    lit->fval = ptkn->fval;
+    if (ptkn->ty == TY_STRLIT) {
+      if (ptkn->array_len < 0) {
+        broken_pch();
+      }
+      lit->ty = array_to(ty_i8, ptkn->array_len);
+      lit->strlit = get_data(ptkn->strlit, ptkn->array_len);
+    } else if (0 < ptkn->ty && ptkn->ty <= PCH_TYPE_CNT) {
+      lit->ty = *pch_types[ptkn->ty - 1];
+    } else if (ptkn->ty != 0) {
+      broken_pch();
+    }
+    tkn->lit = lit;
+  }
+  free(file_len);
+
+  int64_t *arg_names = get_section(header->arg_offset, header->arg_cnt, sizeof(int64_t));
+  PchMacro *pmacros = get_section(header->macro_offset, header->macro_cnt, sizeof(PchMacro));
+  for (int i = 0; i < header->macro_cnt; i++) {
+    PchMacro *pmacro = &pmacros[i];
+    // An object-like macro has no arguments.
+    if ((pmacro->is_objlike != 0 && pmacro->is_objlike != 1) ||
+        (pmacro->is_objlike && pmacro->arg_cnt != 0) ||
+        !in_range(pmacro->arg, pmacro->arg_cnt, header->arg_cnt)) {
+      broken_pch();
+    }
+
+    char *name = get_data_str(pmacro->name);
+    name = intern_atom(name, strlen(name))->name;
+
+    // The predefined macros such as __DATE__ are not overwritten.
+    if (hashmap_get(&macros, name) != NULL) {
+      continue;
+    }
+
+    Macro *macro = calloc(1, sizeof(Macro));
+    macro->name = name;
+    macro->is_objlike = pmacro->is_objlike;
+    macro->expand_tkn = get_item(tkns, pmacro->expand_tkn, tkn_cnt, sizeof(Token));
+
+    MacroArg head = {};
+    MacroArg *cur = &head;
+    for (int j = 0; j < pmacro->arg_cnt; j++) {
+      cur = cur->next = calloc(1, sizeof(MacroArg));
+      char *arg_name = get_data_str(arg_names[pmacro->arg + j]);
+      cur->name = intern_atom(arg_name, strlen(arg_name))->name;
+    }
+    macro->args = head.next;
+    hashmap_insert(&macros, name, macro);
+  }
+
+  PchInclude *pincs = get_section(header->inc_offset, header->inc_cnt, sizeof(PchInclude));
+  for (int i = 0; i < header->inc_cnt; i++) {
+    IncludeFile *inc = calloc(1, sizeof(IncludeFile));
+    if (pincs[i].guard >= 0) {
+      char *guard = get_data_str(pincs[i].guard);
+      inc->guard = intern_atom(guard, strlen(guard))->name;
+    }
+    inc->is_once = pincs[i].is_once;
+    hashmap_insert(&include_files, get_data_str(pincs[i].path), inc);
+  }
+
+  return get_item(tkns, header->head, tkn_cnt, sizeof(Token));
+}
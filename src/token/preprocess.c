@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -17,30 +18,22 @@ struct IncludePath {
   IncludePath *next;
 };
 
-typedef struct MacroArg MacroArg;
-struct MacroArg {
-  char *name;
-  MacroArg *next;
-
-  // The expand_tkn variable stores the token to be replaced and
-  // is used when expanding the macro.
-  Token *expand_tkn;
-};
-
-typedef Token *macro_handler_fn(Token *tkn);
-
-typedef struct {
-  char *name;
-  bool is_objlike;
-
-  Token *expand_tkn;
-  MacroArg *args;
-
-  macro_handler_fn *handler;
-} Macro;
-
 static IncludePath *include_paths;
-static HashMap macros;
+HashMap include_files;
+
+// Cache of the include path resolution.
+// The resolved_includes maps the name with '"' or '<' prefix to the path,
+// and missing_includes has the candidate paths which do not exist.
+static char *cur_dir;
+static HashMap resolved_includes;
+static HashMap missing_includes;
+HashMap macros;
+
+// All included files are recorded for the dependency output.
+// The dependency_paths has the recorded paths to record each path once.
+Dependency *dependencies;
+static Dependency **dependency_tail = &dependencies;
+static HashMap dependency_paths;
 
 void add_include_path(char *path) {
   IncludePath *include_path = calloc(1, sizeof(IncludePath));
@@ -50,7 +43,7 @@ void add_include_path(char *path) {
 }
 
 static Macro *find_macro(Token *tkn) {
-  return hashmap_get(&macros, get_ident(tkn));
+  return hashmap_aget(&macros, get_atom(tkn));
 }
 
 static bool add_macro(char *name, Macro *macro) {
@@ -83,8 +76,8 @@ static void predefine_handler_macro(char *name, macro_handler_fn *handler) {
   add_macro(name, macro);
 }
 
-static void undefine_macro(char *name) {
-  hashmap_delete(&macros, name);
+static void undefine_macro(Atom *name) {
+  hashmap_adelete(&macros, name);
 }
 
 static Token *counter_macro(Token *tkn) {
@@ -110,13 +103,7 @@ static Token *line_macro(Token *tkn) {
     tkn = tkn->ref_tkn;
   }
 
-  int line_no = 1;
-  for (char *loc = tkn->file->contents; loc != tkn->loc; loc++) {
-    if (*loc == '\n') {
-      line_no++;
-    }
-  }
-
+  int line_no = get_line_no(tkn->file, get_orig_loc(tkn->file, tkn->loc));
   char *str = calloc(16, sizeof(char));
   sprintf(str, "%d", line_no);
   return tokenize_file(new_file("builtin", str));
@@ -159,142 +146,155 @@ void init_macro() {
   predefine_handler_macro("__FILE__", file_macro);
 }
 
-static MacroArg *find_macro_arg(Macro *macro, char *name) {
-  for (MacroArg *arg = macro->args; arg != NULL; arg = arg->next) {
-    if (strcmp(arg->name, name) == 0) {
-      return arg;
-    }
+// Return true if tkn is the first token of the next line.
+static bool is_line_end(Token *tkn) {
+  return tkn == NULL || tkn->at_bol || is_eof(tkn);
+}
+
+// Return the last token of the line which tkn belongs to.
+static Token *get_line_tail(Token *tkn) {
+  while (!is_line_end(tkn->next)) {
+    tkn = tkn->next;
   }
-  return NULL;
+  return tkn;
 }
 
-// mask: 0 is all space, 1 is only ' ', 2 is only '\n'
-static bool consume_pp_space(Token *tkn, Token **end_tkn, int mask) {
-  bool chk = false;
-  while (!is_eof(tkn)) {
-    char c = *(tkn->loc);
-    if (tkn->kind != TK_PP) {
-      break;
-    }
+// Return the first token of the next line.
+static Token *skip_line(Token *tkn) {
+  return get_line_tail(tkn)->next;
+}
 
-    if (mask == 0 && !isspace(c)) {
-      break;
-    }
+// Cut the list after the line which tkn belongs to,
+// and the rest variable will point to the first token of the next line.
+static Token *cut_line(Token *tkn, Token **rest) {
+  Token *tail = get_line_tail(tkn);
+  *rest = tail->next;
+  tail->next = NULL;
+  return tkn;
+}
 
-    if (mask == 1 && c != ' ') {
-      break;
-    }
+static Token *expand_preprocess(Token *head);
 
-    if (mask == 2 && c != '\n') {
-      break;
+// Actual argument of a function-like macro invocation
+typedef struct {
+  Token *tkn;         // Tokens of the argument as written
+  Token *expanded;    // Fully macro-expanded tokens of the argument
+  bool is_expanded;   // The argument is expanded when it is needed for the first time
+} MacroActual;
+
+static bool hideset_contains(Hideset *hs, Atom *name) {
+  for (; hs != NULL; hs = hs->next) {
+    if (hs->name == name) {
+      return true;
     }
-
-    chk = true;
-    tkn = tkn->next;
   }
+  return false;
+}
 
-  *end_tkn = tkn;
-  return chk;
+static Hideset *new_hideset(Atom *name, Hideset *next) {
+  Hideset *hs = arena_calloc(&token_arena, 1, sizeof(Hideset));
+  hs->name = name;
+  hs->next = next;
+  return hs;
 }
 
-static void ignore_to_newline(Token *tkn, Token **endtkn) {
-  while (!is_eof(tkn)) {
-    if (tkn->kind == TK_PP && *(tkn->loc) == '\n') {
-      break;
-    }
+// The lists are shared if one of them is empty,
+// since a hideset is never modified after it is made.
+static Hideset *hideset_union(Hideset *lhs, Hideset *rhs) {
+  if (lhs == NULL || lhs == rhs) {
+    return rhs;
+  }
 
-    tkn = tkn->next;
+  for (; lhs != NULL; lhs = lhs->next) {
+    if (!hideset_contains(rhs, lhs->name)) {
+      rhs = new_hideset(lhs->name, rhs);
+    }
   }
-  *endtkn = tkn;
+  return rhs;
 }
 
-
-static Token *concat_separate_ident_token(Token *head) {
-  Token *tkn = calloc(1, sizeof(Token));
-  tkn->next = head;
-  head = tkn;
-
-  while (tkn->next != NULL && tkn->next->next != NULL) {
-    Token *first = tkn->next;
-    Token *second = tkn->next->next;
-
-    if (first->kind != second->kind || first->kind != TK_IDENT) {
-      tkn = tkn->next;
-      continue;
+static Hideset *hideset_intersection(Hideset *lhs, Hideset *rhs) {
+  Hideset *hs = NULL;
+  for (; lhs != NULL; lhs = lhs->next) {
+    if (hideset_contains(rhs, lhs->name)) {
+      hs = new_hideset(lhs->name, hs);
     }
+  }
+  return hs;
+}
 
-    char *ptr = first->loc;
-    char *endptr = second->loc + second->len;
+// A constant macro is an object-like macro whose body is a single literal,
+// such as "#define BUF_SIZE 4096".
+static bool is_const_macro(Macro *macro) {
+  Token *body = macro->expand_tkn;
+  return macro->is_objlike && macro->handler == NULL && body != NULL && body->next == NULL &&
+         (body->kind == TK_NUM || body->kind == TK_STR);
+}
 
-    first = new_token(TK_IDENT, ptr, endptr - ptr);
-    first->next = second->next;
-    tkn->next = first;
+static bool is_va_args(MacroArg *arg) {
+  static char *va_args;
+  if (va_args == NULL) {
+    va_args = intern_atom("__VA_ARGS__", 11)->name;
   }
-
-  return head->next;
+  return arg->name == va_args;
 }
 
-static Token *delete_pp_token(Token *tkn) {
-  Token *before = calloc(1, sizeof(Token));
-  Token *now = before->next = tkn;
-  tkn = before;
+// Return the actual argument if tkn is a parameter of the macro.
+static MacroActual *find_macro_actual(Macro *macro, MacroActual *actuals, Token *tkn) {
+  if (tkn == NULL || tkn->kind != TK_IDENT) {
+    return NULL;
+  }
 
-  while (now != NULL) {
-    if (now->kind == TK_PP) {
-      before->next = now = now->next;
-      continue;
+  char *name = get_ident(tkn);
+  int idx = 0;
+  for (MacroArg *arg = macro->args; arg != NULL; arg = arg->next, idx++) {
+    if (arg->name == name) {
+      return &actuals[idx];
     }
-
-    before = now;
-    now = now->next;
   }
-
-  return tkn->next;
+  return NULL;
 }
 
-static Token *delete_enclose_pp_token(Token *tkn) {
-  consume_pp_space(tkn, &tkn, 0);
-  Token *head = tkn;
-
-  Token *tail = tkn;
-  while (tkn != NULL) {
-    if (tkn->kind != TK_PP) {
-      tail = tkn;
+// Append the copies of the tokens to cur, and return the last token.
+static Token *append_copy(Token *cur, Token *tkn, Token *ref_tkn) {
+  for (; tkn != NULL; tkn = tkn->next) {
+    cur = cur->next = copy_token(tkn);
+    if (ref_tkn != NULL) {
+      cur->ref_tkn = ref_tkn;
     }
-    tkn = tkn->next;
   }
-  tail->next = NULL;
-
-  return head;
+  return cur;
 }
 
-static Token *copy_token(Token *tkn) {
-  Token *cpy = calloc(1, sizeof(Token));
-  memcpy(cpy, tkn, sizeof(Token));
-  cpy->next = NULL;
-  return cpy;
+// The argument is expanded only if the parameter appears in the body
+// other than the operand of '#' or '##', and only once for all of them.
+static Token *expand_macro_actual(MacroActual *actual, Token *param_ref) {
+  if (!actual->is_expanded) {
+    Token head = {};
+    append_copy(&head, actual->tkn, param_ref);
+    actual->expanded = expand_preprocess(head.next);
+    actual->is_expanded = true;
+  }
+  return actual->expanded;
 }
 
-static Token *expand_preprocess(Token *head);
-
-static Token *copy_arg_expand_tkn(MacroArg *arg, Token *ref_tkn) {
-  Token head = {};
-  Token *cur = &head;
-
-  for (Token *expand_tkn = arg->expand_tkn; expand_tkn != NULL; expand_tkn = expand_tkn->next) {
-    cur->next = calloc(1, sizeof(Token));
-    memcpy(cur->next, expand_tkn, sizeof(Token));
-
-    cur = cur->next;
-    cur->ref_tkn = copy_token(ref_tkn);
+// Write the token to fp, and escape '"' and '\' in literals
+// if the token is written in a string literal.
+static void write_token(FILE *fp, Token *tkn, bool has_dquote) {
+  if (!has_dquote || (tkn->kind != TK_STR && *tkn->loc != '\'')) {
+    fwrite(tkn->loc, sizeof(char), tkn->len, fp);
+    return;
   }
 
-  return head.next;
+  for (int i = 0; i < tkn->len; i++) {
+    if (tkn->loc[i] == '"' || tkn->loc[i] == '\\') {
+      putc('\\', fp);
+    }
+    putc(tkn->loc[i], fp);
+  }
 }
 
 static char *stringizing(Token *tkn, bool has_dquote) {
-  tkn = delete_enclose_pp_token(tkn);
-
   char *buf;
   size_t buflen;
   FILE *fp = open_memstream(&buf, &buflen);
@@ -303,15 +303,27 @@ static char *stringizing(Token *tkn, bool has_dquote) {
     putc('"', fp);
   }
 
+  bool is_first = true;
   while (tkn != NULL) {
-    if (consume_pp_space(tkn, &tkn, 0)) {
-      putc(' ', fp);
+    // The body of a conditional group is stringized with its tokens.
+    if (tkn->kind == TK_GROUP) {
+      Token *group = tokenize_group(tkn);
+      if (group != NULL) {
+        get_tail_token(group)->next = tkn->next;
+        tkn = group;
+      } else {
+        tkn = tkn->next;
+      }
       continue;
     }
 
-    char *str = erase_bslash_str(tkn->loc, tkn->len);
-    fwrite(str, sizeof(char), strlen(str), fp);
-    free(str);
+    // Spaces between tokens become a single space.
+    if (!is_first && tkn->has_space) {
+      putc(' ', fp);
+    }
+    is_first = false;
+
+    write_token(fp, tkn, has_dquote);
     tkn = tkn->next;
   }
 
@@ -326,181 +338,216 @@ static char *stringizing(Token *tkn, bool has_dquote) {
   return buf;
 }
 
-static Token *copy_expand_tkn(Macro *macro, Token *ref_tkn) {
-  Token *head = calloc(1, sizeof(Token));
-  Token *cur = head;
+// Concatenate lhs and rhs by '##', and overwrite lhs with the result.
+// Return the last token of the result.
+static Token *paste_token(Token *lhs, Token *rhs) {
+  char *str = arena_calloc(&string_arena, lhs->len + rhs->len + 1, sizeof(char));
+  memcpy(str, lhs->loc, lhs->len);
+  memcpy(str + lhs->len, rhs->loc, rhs->len);
+
+  Token *con_tkn = tokenize_file(new_file("builtin", str));
+  if (con_tkn == NULL) {
+    errorf_tkn(ER_COMPILE, lhs, "pasting does not give a valid preprocessing token");
+  }
+  Token *ref_tkn = copy_token(lhs);
+  bool has_space = lhs->has_space;
+
+  *lhs = *con_tkn;
+  lhs->has_space = has_space;
+  for (Token *tkn = lhs; tkn != NULL; tkn = tkn->next) {
+    tkn->ref_tkn = ref_tkn;
+    lhs = tkn;
+  }
+  return lhs;
+}
+
+// Substitute the arguments for the parameters in the body of the macro,
+// and return the expansion. The tail variable will point to the last token.
+// All tokens of the expansion get the hideset.
+static Token *subst_macro(Macro *macro, MacroActual *actuals, Token *ref_tkn, Hideset *hs, Token **tail) {
+  Token head = {};
+  Token *cur = &head;
+  Token *expand_ref = copy_token(ref_tkn);
 
   if (macro->handler != NULL) {
     cur->next = macro->handler(ref_tkn);
-    for (Token *expand_tkn = cur->next; cur != NULL; cur = cur->next) {
-      expand_tkn->ref_tkn = copy_token(ref_tkn);
+    for (; cur->next != NULL; cur = cur->next) {
+      cur->next->ref_tkn = expand_ref;
     }
-    return head->next;
   }
 
-  for (Token *expand_tkn = macro->expand_tkn; expand_tkn != NULL; expand_tkn = expand_tkn->next) {
-    cur->next = calloc(1, sizeof(Token));
-    memcpy(cur->next, expand_tkn, sizeof(Token));
+  // True if the last operand of '##' was an empty argument,
+  // which is replaced with nothing instead of being concatenated.
+  bool is_empty_operand = false;
 
-    cur = cur->next;
-    cur->ref_tkn = copy_token(ref_tkn);
-  }
+  for (Token *body = macro->expand_tkn; body != NULL; body = body->next) {
+    MacroActual *actual = NULL;
 
-  // Expand macro arguments
-  cur = head;
-  while (cur->next != NULL) {
     // Stringizing
-    if (equal(cur->next, "#") && cur->next->next != NULL) {
-      MacroArg *arg = find_macro_arg(macro, get_ident(cur->next->next));
-      if (arg == NULL) {
-        errorf_tkn(ER_COMPILE, cur->next, "'#' is not follwed by a macro parameter");
+    if (!macro->is_objlike && equal_id(body, PN_HASH)) {
+      if ((actual = find_macro_actual(macro, actuals, body->next)) == NULL) {
+        errorf_tkn(ER_COMPILE, body, "'#' is not follwed by a macro parameter");
       }
 
-      char *loc = cur->next->loc;
-      int len = cur->next->next->loc - loc + cur->next->next->len;
-      Token *ref_tkn = copy_token(cur->next);
-      ref_tkn->len = len;
+      Token *str_ref = copy_token(body);
+      str_ref->ref_tkn = expand_ref;
 
-      Token *tail = cur->next->next->next;
-
-      char *str = stringizing(copy_arg_expand_tkn(arg, ref_tkn), true);
-      cur->next = tokenize_file(new_file("builtin", str));
-      cur->next->ref_tkn = ref_tkn;
-      cur->next->next = tail;
+      cur = cur->next = tokenize_file(new_file("builtin", stringizing(actual->tkn, true)));
+      cur->ref_tkn = str_ref;
+      cur->has_space = body->has_space;
+      body = body->next;
+      is_empty_operand = false;
       continue;
     }
 
     // Concatenate
-    if (cur->next->next != NULL && equal(cur->next->next, "##")) {
-      Token *lhs = cur->next;
-      Token *rhs = cur->next->next->next;
-      Token *tail = rhs->next;
-
+    if (equal_id(body, PN_HASHHASH)) {
+      Token *rhs = body->next;
       if (rhs == NULL) {
-        errorf_tkn(ER_COMPILE, lhs->next, "'##' cannot appear at end of macro expansion");
+        errorf_tkn(ER_COMPILE, body, "'##' cannot appear at end of macro expansion");
       }
-
-      Token *ref_tkn = copy_token(lhs);
-      ref_tkn->len = rhs->loc - lhs->loc + rhs->len;
-      char *lstr;
-      char *rstr;
-
-      MacroArg *arg = NULL;
-      if ((arg = find_macro_arg(macro, get_ident(lhs))) != NULL) {
-        lhs = copy_arg_expand_tkn(arg, ref_tkn);
-        lhs = delete_enclose_pp_token(lhs);
+      if (cur == &head && !is_empty_operand) {
+        errorf_tkn(ER_COMPILE, body, "'##' cannot appear at beginning of macro expansion");
       }
-      lstr = stringizing(lhs, false);
-
-      if ((arg = find_macro_arg(macro, get_ident(rhs))) != NULL) {
-        rhs = copy_arg_expand_tkn(arg, ref_tkn);
-        rhs = delete_enclose_pp_token(rhs);
+      body = rhs;
+
+      Token *rhs_tkn = rhs;
+      Token *rhs_ref = expand_ref;
+      if ((actual = find_macro_actual(macro, actuals, rhs)) != NULL) {
+        rhs_tkn = actual->tkn;
+        rhs_ref = copy_token(rhs);
+        rhs_ref->ref_tkn = expand_ref;
+      } else {
+        rhs_tkn = copy_token(rhs);
       }
-      rstr = stringizing(rhs, false);
 
-      char *str = calloc(strlen(lstr) + strlen(rstr) + 8, sizeof(char));
-      strcat(str, lstr), strcat(str, rstr);
-      free(lstr), free(rstr);
-
-      Token *con_tkn = tokenize_file(new_file("builtin", str));
-
-      // Set reference token
-      for (Token *tkn = con_tkn; tkn != NULL; tkn = tkn->next) {
-        Token *ref = tkn;
-        for (;ref->ref_tkn != NULL; ref = ref->ref_tkn) {
-          ref = ref->ref_tkn;
-        }
-        ref->ref_tkn = ref_tkn;
+      if (rhs_tkn == NULL) {
+        continue;
       }
 
-      get_tail_token(con_tkn)->next = tail;
-      cur->next = con_tkn;
-      cur = get_tail_token(con_tkn);
+      if (is_empty_operand) {
+        cur = append_copy(cur, rhs_tkn, rhs_ref);
+      } else {
+        Token *rest = rhs_tkn->next;
+        cur = paste_token(cur, rhs_tkn);
+        cur = append_copy(cur, rest, rhs_ref);
+      }
+      is_empty_operand = false;
       continue;
     }
 
-    if (cur->next->kind != TK_IDENT) {
-      cur = cur->next;
+    if ((actual = find_macro_actual(macro, actuals, body)) == NULL) {
+      cur = cur->next = copy_token(body);
+      cur->ref_tkn = expand_ref;
+      is_empty_operand = false;
       continue;
     }
 
-    MacroArg *arg = find_macro_arg(macro, get_ident(cur->next));
-    if (arg == NULL) {
-      cur = cur->next;
-      continue;
+    Token *param_ref = copy_token(body);
+    param_ref->ref_tkn = expand_ref;
+    Token *begin = cur;
+
+    // The operand of '##' is not expanded.
+    if (body->next != NULL && equal_id(body->next, PN_HASHHASH)) {
+      cur = append_copy(cur, actual->tkn, param_ref);
+      is_empty_operand = actual->tkn == NULL;
+    } else {
+      cur = append_copy(cur, expand_macro_actual(actual, param_ref), NULL);
+      is_empty_operand = false;
+    }
+
+    if (begin->next != NULL) {
+      begin->next->has_space = body->has_space;
     }
+  }
 
-    Token *expand_tkn = copy_arg_expand_tkn(arg, cur->next);
-    expand_tkn = expand_preprocess(expand_tkn);
+  cur->next = NULL;
+  for (Token *tkn = head.next; tkn != NULL; tkn = tkn->next) {
+    tkn->hideset = hideset_union(tkn->hideset, hs);
+  }
 
-    get_tail_token(expand_tkn)->next = cur->next->next;
-    cur->next = expand_tkn;
+  // The expansion is spaced like the macro invocation.
+  if (head.next != NULL) {
+    head.next->has_space = ref_tkn->has_space;
   }
 
-  return head->next;
+  *tail = cur;
+  return head.next;
 }
 
-static void set_macro_args(Macro *macro, Token *tkn, Token **end_tkn) {
-  if (!consume(tkn, &tkn, "(")) {
-    errorf_tkn(ER_COMPILE, tkn, "Unexpected macro");
-  }
+// Read the arguments of the function-like macro invocation, and tkn is '('.
+// The tokens of each argument are cut from the list.
+// The rparen variable will point to ')' of the invocation.
+static MacroActual *read_macro_args(Macro *macro, Token *tkn, Token **rparen) {
+  Token *lparen = tkn;
+  tkn = skip_id(tkn, PN_LPAREN);
 
   MacroArg *arg = macro->args;
-
-  bool need_commma = false;
-  while (!equal(tkn, ")")) {
-    if (arg == NULL) {
+  if (arg == NULL) {
+    if (!equal_id(tkn, PN_RPAREN)) {
       errorf_tkn(ER_COMPILE, tkn, "The number of arguments does not match");
     }
+    *rparen = tkn;
+    return NULL;
+  }
 
-    if (need_commma) {
-      tkn = skip(tkn, ",");
-    }
-    need_commma = true;
-
-    Token *expand_tkn = tkn;
-    bool is_va_args = (strcmp(arg->name, "__VA_ARGS__") == 0);
-    int pass_lparenthese = 0;
-    while (true) {
-      if (pass_lparenthese != 0 && equal(tkn, ")")) {
-        pass_lparenthese--;
-      }
+  int cnt = 0;
+  for (MacroArg *cur = arg; cur != NULL; cur = cur->next) {
+    cnt++;
+  }
+  MacroActual *actuals = arena_calloc(&token_arena, cnt, sizeof(MacroActual));
 
-      if (equal(tkn, "(")) {
-        pass_lparenthese++;
-      }
+  Token head = {};
+  Token *cur = &head;
+  int idx = 0, depth = 0;
+  while (true) {
+    if (tkn == NULL) {
+      errorf_tkn(ER_COMPILE, lparen, "Unterminated macro invocation");
+    }
 
-      if (pass_lparenthese == 0 && ((!is_va_args && equal(tkn->next, ",")) || equal(tkn->next, ")"))) {
-        Token *tail = tkn->next;
-        tkn->next = NULL;
-        tkn = tail;
+    if (depth == 0 && (equal_id(tkn, PN_RPAREN) || (equal_id(tkn, PN_COMMA) && !is_va_args(arg)))) {
+      cur->next = NULL;
+      actuals[idx++].tkn = head.next;
+      if (equal_id(tkn, PN_RPAREN)) {
         break;
       }
 
+      if ((arg = arg->next) == NULL) {
+        errorf_tkn(ER_COMPILE, tkn, "The number of arguments does not match");
+      }
+      cur = &head;
       tkn = tkn->next;
+      continue;
     }
 
-    arg->expand_tkn = expand_tkn;
-    arg = arg->next;
+    if (equal_id(tkn, PN_LPAREN)) {
+      depth++;
+    } else if (equal_id(tkn, PN_RPAREN)) {
+      depth--;
+    }
+    cur = cur->next = tkn;
+    tkn = tkn->next;
   }
 
-  if (arg != NULL && strcmp(arg->name, "__VA_ARGS__") != 0) {
+  // Only the variable arguments can be omitted.
+  if (arg->next != NULL && !is_va_args(arg->next)) {
     errorf_tkn(ER_COMPILE, tkn, "The number of arguments does not match");
   }
 
-  *end_tkn = tkn->next;
+  *rparen = tkn;
+  return actuals;
 }
 
 // Logical expressions need to have val variable in front,
 // since the back may not be evaluated.
-#define EVAL_OP(op, mask) \
-  if (!is_eof(tkn) && consume(tkn, &tkn, #op)) { \
+#define EVAL_OP(op, id, mask) \
+  if (!is_eof(tkn) && consume_id(tkn, &tkn, id)) { \
     val = (eval_const_expr(tkn, end_tkn, mask) op val); \
     return val; \
   }
 
-#define EVAL_UNARY_OP(op, mask) \
-  if (!is_eof(tkn) && consume(tkn, &tkn, #op)) { \
+#define EVAL_UNARY_OP(op, id, mask) \
+  if (!is_eof(tkn) && consume_id(tkn, &tkn, id)) { \
     int64_t val = op eval_const_expr(tkn, end_tkn, mask); \
     return val; \
   }
@@ -514,7 +561,7 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
 
     if (tkn->kind == TK_NUM) {
       *end_tkn = tkn->next;
-      return tkn->val;
+      return tkn->lit->val;
     }
 
     if (tkn->kind == TK_IDENT) {
@@ -522,9 +569,9 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
       return 0;
     }
 
-    if (consume(tkn, &tkn, "(")) {
+    if (consume_id(tkn, &tkn, PN_LPAREN)) {
       int64_t val = eval_const_expr(tkn, &tkn, 12);
-      tkn = skip(tkn, ")");
+      tkn = skip_id(tkn, PN_RPAREN);
 
       *end_tkn = tkn;
       return val;
@@ -533,10 +580,10 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
 
   // mask 1: unary
   if (mask == 1) {
-    EVAL_UNARY_OP(+, 1)
-    EVAL_UNARY_OP(-, 1)
-    EVAL_UNARY_OP(~, 1)
-    EVAL_UNARY_OP(!, 1)
+    EVAL_UNARY_OP(+, PN_ADD, 1)
+    EVAL_UNARY_OP(-, PN_SUB, 1)
+    EVAL_UNARY_OP(~, PN_TILDE, 1)
+    EVAL_UNARY_OP(!, PN_NOT, 1)
 
     int64_t val = eval_const_expr(tkn, &tkn, 0);
     *end_tkn = tkn;
@@ -546,9 +593,9 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 2: mul
   if (mask == 2) {
     int val = eval_const_expr(tkn, &tkn, 1);
-    EVAL_OP(*, 2)
-    EVAL_OP(/, 2)
-    EVAL_OP(%, 2)
+    EVAL_OP(*, PN_MUL, 2)
+    EVAL_OP(/, PN_DIV, 2)
+    EVAL_OP(%, PN_MOD, 2)
 
     *end_tkn = tkn;
     return val;
@@ -557,8 +604,8 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 3: add
   if (mask == 3) {
     int val = eval_const_expr(tkn, &tkn, 2);
-    EVAL_OP(+, 3)
-    EVAL_OP(-, 3)
+    EVAL_OP(+, PN_ADD, 3)
+    EVAL_OP(-, PN_SUB, 3)
 
     *end_tkn = tkn;
     return val;
@@ -567,8 +614,8 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 4: bitshift
   if (mask == 4) {
     int val = eval_const_expr(tkn, &tkn, 3);
-    EVAL_OP(<<, 4)
-    EVAL_OP(>>, 4)
+    EVAL_OP(<<, PN_SHL, 4)
+    EVAL_OP(>>, PN_SHR, 4)
 
     *end_tkn = tkn;
     return val;
@@ -577,10 +624,10 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 5: relational
   if (mask == 5) {
     int val = eval_const_expr(tkn, &tkn, 4);
-    EVAL_OP(<, 5);
-    EVAL_OP(>, 5);
-    EVAL_OP(<=, 7);
-    EVAL_OP(>=, 5);
+    EVAL_OP(<, PN_LT, 5);
+    EVAL_OP(>, PN_GT, 5);
+    EVAL_OP(<=, PN_LE, 7);
+    EVAL_OP(>=, PN_GE, 5);
 
     *end_tkn = tkn;
     return val;
@@ -589,8 +636,8 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 6: quality
   if (mask == 6) {
     int val = eval_const_expr(tkn, &tkn, 5);
-    EVAL_OP(==, 6)
-    EVAL_OP(!=, 6)
+    EVAL_OP(==, PN_EQ, 6)
+    EVAL_OP(!=, PN_NE, 6)
 
     *end_tkn = tkn;
     return val;
@@ -599,7 +646,7 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 7: bitand
   if (mask == 7) {
     int val = eval_const_expr(tkn, &tkn, 6);
-    EVAL_OP(&, 7);
+    EVAL_OP(&, PN_AND, 7);
 
     *end_tkn = tkn;
     return val;
@@ -608,7 +655,7 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 8: bitxor
   if (mask == 8) {
     int val = eval_const_expr(tkn, &tkn, 7);
-    EVAL_OP(^, 8)
+    EVAL_OP(^, PN_XOR, 8)
 
     *end_tkn = tkn;
     return val;
@@ -617,7 +664,7 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 9: bitor
   if (mask == 9) {
     int val = eval_const_expr(tkn, &tkn, 8);
-    EVAL_OP(|, 9)
+    EVAL_OP(|, PN_OR, 9)
 
     *end_tkn = tkn;
     return val;
@@ -626,7 +673,7 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 10: logand
   if (mask == 10) {
     int val = eval_const_expr(tkn, &tkn, 9);
-    EVAL_OP(&&, 10)
+    EVAL_OP(&&, PN_LOGAND, 10)
 
     *end_tkn = tkn;
     return val;
@@ -635,7 +682,7 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   // mask 11: logor
   if (mask == 11) {
     int val = eval_const_expr(tkn, &tkn, 10);
-    EVAL_OP(||, 11)
+    EVAL_OP(||, PN_LOGOR, 11)
 
     *end_tkn = tkn;
     return val;
@@ -645,9 +692,9 @@ static int64_t eval_const_expr(Token *tkn, Token **end_tkn, int mask) {
   if (mask == 12) {
     int val = eval_const_expr(tkn, &tkn, 11);
 
-    if (!is_eof(tkn) && consume(tkn, &tkn, "?")) {
+    if (!is_eof(tkn) && consume_id(tkn, &tkn, PN_QUESTION)) {
       int lval = eval_const_expr(tkn, &tkn, 12);
-      tkn = skip(tkn, ":");
+      tkn = skip_id(tkn, PN_COLON);
       int rval = eval_const_expr(tkn, end_tkn, 12);
       return val ? lval : rval;
     }
@@ -674,10 +721,10 @@ static Token *expand_defined_op(Token *tkn) {
       Token *ref_tkn = NULL;
       Macro *macro = NULL;
 
-      if (consume(head->next, &(head->next), "(")) {
+      if (consume_id(head->next, &(head->next), PN_LPAREN)) {
         ref_tkn = head->next;
         macro = find_macro(head->next);
-        head->next = skip(head->next->next, ")");
+        head->next = skip_id(head->next->next, PN_RPAREN);
       } else {
         ref_tkn = head->next;
         macro = find_macro(head->next);
@@ -685,7 +732,7 @@ static Token *expand_defined_op(Token *tkn) {
       }
       
       Token *val_tkn = new_token(TK_NUM, strdup("10"), 2);
-      val_tkn->val = macro != NULL;
+      new_literal(val_tkn)->val = macro != NULL;
       val_tkn->ref_tkn = ref_tkn;
 
       val_tkn->next = head->next;
@@ -699,257 +746,550 @@ static Token *expand_defined_op(Token *tkn) {
   return tkn->next;
 }
 
-static Token *expand_if_group(Token *tkn, Token **end_tkn) {
-  Token *head = NULL;
+// Return true if tkn is '#' of the directive.
+static bool is_directive(Token *tkn, char *name) {
+  return tkn->at_bol && !is_eof(tkn) && equal_id(tkn, PN_HASH) && !is_line_end(tkn->next) &&
+         equal(tkn->next, name);
+}
 
-  while (!(equal(tkn, "#") && equal(tkn->next, "endif"))) {
-    if (equal(tkn->next, "#")) {
-      Token *tmp = tkn->next;
-      tkn->next = NULL;
-      tkn = tmp;
+// Find '#' of "#elif", "#else" or "#endif" which ends the conditional group
+// beginning at tkn. Nested conditional groups are skipped.
+// The token before the found '#' is stored in the prev variable,
+// and it is NULL if the group body is empty.
+static Token *find_group_end(Token *tkn, Token **prev) {
+  *prev = NULL;
+
+  int depth = 0;
+  for (; tkn != NULL && !is_eof(tkn); *prev = tkn, tkn = tkn->next) {
+    if (!tkn->at_bol) {
       continue;
     }
 
-    if (!equal(tkn, "#")) {
-      tkn = tkn->next;
+    if (is_directive(tkn, "if") || is_directive(tkn, "ifdef") || is_directive(tkn, "ifndef")) {
+      depth++;
       continue;
     }
 
-    if (equal(tkn->next, "ifdef") || equal(tkn->next, "ifndef")) {
-      bool negative = equal(tkn->next, "ifndef");
-
-      Token *expand_tkn = tkn->next->next, *tail;
-      ignore_to_newline(expand_tkn, &tail);
-      tkn->next = tail->next;
-      tail->next = NULL;
-
-      expand_tkn = delete_pp_token(expand_tkn);
-      Macro *macro = NULL;
-      macro = find_macro(expand_tkn);
-
-      if (negative ^ (macro != NULL)) {
-        head = tkn->next;
+    if (is_directive(tkn, "endif")) {
+      if (depth == 0) {
+        return tkn;
       }
+      depth--;
       continue;
     }
 
-    if (equal(tkn->next, "if") || (head == NULL && equal(tkn->next, "elif"))) {
-      Token *expand_tkn = tkn->next->next, *tail;
-      ignore_to_newline(expand_tkn, &tail);
-      tkn->next = tail->next;
-      tail->next = NULL;
+    if (depth == 0 && (is_directive(tkn, "elif") || is_directive(tkn, "else"))) {
+      return tkn;
+    }
+  }
 
-      expand_tkn = delete_pp_token(expand_tkn);
-      expand_tkn = expand_defined_op(expand_tkn);
-      expand_tkn = expand_preprocess(expand_tkn);
-      add_eof_token(expand_tkn);
+  return NULL;
+}
 
-      int64_t val = eval_const_expr(expand_tkn, &expand_tkn, 12);
+// Evaluate the condition of "#if", "#elif", "#ifdef" or "#ifndef",
+// and tkn is '#' of the directive.
+static bool eval_if_cond(Token *tkn) {
+  Token *rest;
+  cut_line(tkn, &rest);
+  Token *expand_tkn = tkn->next->next;
 
-      if (val) {
-        head = tkn->next;
-      }
+  if (equal(tkn->next, "ifdef") || equal(tkn->next, "ifndef")) {
+    bool negative = equal(tkn->next, "ifndef");
+    return negative ^ (find_macro(expand_tkn) != NULL);
+  }
+
+  expand_tkn = expand_defined_op(expand_tkn);
+  expand_tkn = expand_preprocess(expand_tkn);
+  add_eof_token(expand_tkn);
+
+  return eval_const_expr(expand_tkn, &expand_tkn, 12) != 0;
+}
+
+// Replace TK_GROUP tokens in the group body with their tokens.
+static Token *tokenize_group_body(Token *tkn) {
+  Token head = {};
+  Token *cur = &head;
+
+  for (; tkn != NULL; tkn = tkn->next) {
+    if (tkn->kind != TK_GROUP) {
+      cur = cur->next = tkn;
       continue;
     }
 
-    if (head == NULL && equal(tkn->next, "else")) {
-      head = tkn->next->next;
+    cur->next = tokenize_group(tkn);
+    if (cur->next != NULL) {
+      cur = get_tail_token(cur->next);
+    }
+  }
+  cur->next = NULL;
+  return head.next;
+}
+
+// Return the tokens of the group whose condition is true,
+// and tkn is '#' of the "#if", "#ifdef" or "#ifndef".
+// The end_tkn variable will point to the next token of "#endif" line.
+static Token *expand_if_group(Token *tkn, Token **end_tkn) {
+  Token *head = NULL;
+  bool is_taken = false;
+
+  while (!is_directive(tkn, "endif")) {
+    Token *body = skip_line(tkn);
+    Token *prev;
+    Token *group_end = find_group_end(body, &prev);
+    if (group_end == NULL) {
+      errorf_tkn(ER_COMPILE, tkn, "Unterminated conditional directive");
+    }
+
+    if (!is_taken && (is_directive(tkn, "else") || eval_if_cond(tkn))) {
+      is_taken = true;
+
+      // The body is empty if there is no token before the end of the group.
+      if (prev != NULL) {
+        prev->next = NULL;
+        head = tokenize_group_body(body);
+      }
+    } else if (body->kind == TK_GROUP) {
+      token_stats.skipped_bytes += body->len;
     }
 
-    tkn = tkn->next;
+    tkn = group_end;
   }
 
-  *end_tkn = tkn->next->next;
+  *end_tkn = skip_line(tkn);
   return head;
 }
 
-static Token *expand_preprocess(Token *head) {
-  Token *tkn = calloc(1, sizeof(Token));
-  tkn->next = head;
-  head = tkn;
+// A file is guarded by the include guard if it has the following structure,
+// and there are no tokens outside the conditional group.
+//
+//   #ifndef NAME
+//   #define NAME
+//   ...
+//   #endif
+//
+// If the file is guarded, return the name of the include guard.
+static char *find_include_guard(Token *tkn) {
+  if (tkn == NULL || !is_directive(tkn, "ifndef")) {
+    return NULL;
+  }
 
-  while (tkn->next != NULL && !is_eof(tkn->next)) {
-    if (tkn->next->kind == TK_IDENT && find_macro(tkn->next) != NULL) {
-      Macro *macro = find_macro(tkn->next);
-      Token *ref_tkn = tkn->next;
+  Token *ifndef_tkn = tkn;
+  tkn = tkn->next->next;
+  if (is_line_end(tkn) || tkn->kind != TK_IDENT) {
+    return NULL;
+  }
+  char *name = get_ident(tkn);
+
+  // Following "#define NAME"
+  // The group body is tokenized in advance, since it is taken at the first inclusion.
+  Token *body = get_line_tail(ifndef_tkn);
+  if (body->next != NULL && body->next->kind == TK_GROUP) {
+    Token *group = tokenize_group(body->next);
+    if (group != NULL) {
+      get_tail_token(group)->next = body->next->next;
+      body->next = group;
+    } else {
+      body->next = body->next->next;
+    }
+  }
+  tkn = body->next;
+  if (tkn == NULL || !is_directive(tkn, "define")) {
+    return NULL;
+  }
 
-      if (!macro->is_objlike && !equal(tkn->next->next, "(")) {
-        tkn = tkn->next;
-        continue;
-      }
-      tkn->next = tkn->next->next;
+  tkn = tkn->next->next;
+  if (is_line_end(tkn) || tkn->kind != TK_IDENT || get_ident(tkn) != name) {
+    return NULL;
+  }
 
-      if (!macro->is_objlike) {
-        set_macro_args(macro, tkn->next, &(tkn->next));
-      }
+  Token *prev;
+  Token *group_end = find_group_end(body->next, &prev);
+  if (group_end == NULL || !is_directive(group_end, "endif")) {
+    return NULL;
+  }
 
-      Token *expand_tkn = copy_expand_tkn(macro, ref_tkn);
-      get_tail_token(expand_tkn)->next = tkn->next;
-      tkn->next = expand_tkn;
-      continue;
-    }
+  tkn = skip_line(group_end);
+  if (tkn != NULL && !is_eof(tkn)) {
+    return NULL;
+  }
+  return name;
+}
 
-    if (!equal(tkn->next, "#") || tkn->next->next == NULL || is_eof(tkn->next->next)) {
-        tkn = tkn->next;
-        continue;
-    }
+static Token *copy_token_list(Token *tkn) {
+  Token head = {};
+  Token *cur = &head;
 
-    if (equal(tkn->next->next, "define")) {
-      Token *expand_tkn = tkn->next->next->next, *tail;
-      ignore_to_newline(expand_tkn, &tail);
-      tkn->next = tail->next;
-      tail->next = NULL;
+  for (; tkn != NULL; tkn = tkn->next) {
+    cur = cur->next = copy_token(tkn);
+  }
+  return head.next;
+}
 
-      expand_tkn = delete_pp_token(expand_tkn);
+static IncludeFile *get_include_file(char *path) {
+  IncludeFile *inc = hashmap_get(&include_files, path);
+  if (inc == NULL) {
+    inc = calloc(1, sizeof(IncludeFile));
+    hashmap_insert(&include_files, path, inc);
+  }
+  return inc;
+}
 
-      char *name = get_ident(expand_tkn);
-      bool is_objlike = true;
-      expand_tkn = expand_tkn->next;
+// Return the tokens of the file in the path.
+// If the file does not exist, the is_found variable is set to false.
+// If the file need not be included again, NULL is returned.
+static Token *read_include_path(char *path, bool *is_found) {
+  IncludeFile *inc = hashmap_get(&include_files, path);
+  *is_found = true;
+
+  if (inc != NULL) {
+    if (inc->is_once || (inc->guard != NULL && hashmap_get(&macros, inc->guard) != NULL)) {
+      token_stats.guard_skips++;
+      return NULL;
+    }
 
-      MacroArg head = {};
-      MacroArg *cur = &head;
+    struct stat st;
+    if (inc->tkn != NULL && stat(path, &st) == 0 &&
+        st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec == inc->mtime) {
+      token_stats.cache_hits++;
+      return copy_token_list(inc->tkn);
+    }
+  }
 
-      if (consume(expand_tkn, &expand_tkn, "(")) {
-        is_objlike = false;
+  File *file = open_builtin_header(path);
+  if (file == NULL && (file = open_file(path)) == NULL) {
+    *is_found = false;
+    return NULL;
+  }
+  token_stats.cache_misses++;
+
+  Token *tkn = tokenize_file(file);
+  inc = get_include_file(file->name);
+  inc->guard = find_include_guard(tkn);
+  inc->mtime = file->mtime;
+  inc->tkn = NULL;
+
+  // The guarded file is not included again while the guard is defined,
+  // so the tokens are cached only if the file is not guarded.
+  // The preprocessor rewrites the token list, so the cached tokens are copied.
+  if (inc->guard == NULL) {
+    inc->tkn = tkn;
+    return copy_token_list(tkn);
+  }
+  return tkn;
+}
 
-        while (!consume(expand_tkn, &expand_tkn, ")")) {
-          if (cur != &head) {
-            expand_tkn = skip(expand_tkn, ",");
-          }
+// A path is recorded when a name is resolved to it for the first time,
+// so it is recorded even if the file is skipped by the include guard.
+static void add_dependency(char *path, bool is_system) {
+  if (hashmap_get(&dependency_paths, path) != NULL) {
+    return;
+  }
 
-          cur->next = calloc(1, sizeof(MacroArg));
-          cur = cur->next;
+  Dependency *dep = calloc(1, sizeof(Dependency));
+  dep->path = path;
+  dep->is_system = is_system;
+  *dependency_tail = dep;
+  dependency_tail = &dep->next;
+  hashmap_insert(&dependency_paths, path, dep);
+}
 
-          if (equal(expand_tkn, ".")) {
-            for (int i = 0; i < 3; i++) {
-              expand_tkn = skip(expand_tkn, ".");
-            }
-            cur->name = "__VA_ARGS__";
-            expand_tkn = skip(expand_tkn, ")");
-            break;
-          }
+// Return the path of the included file, or NULL if the file does not exist.
+// The name is searched in the current directory if is_curdir is true,
+// otherwise it is searched in the include paths.
+// The resolved paths and the missing candidates are cached,
+// so the same name is resolved without stat or open again.
+static char *resolve_include(char *name, bool is_curdir) {
+  if (cur_dir == NULL) {
+    cur_dir = getcwd(NULL, 0);
+  }
 
-          cur->name = get_ident(expand_tkn);
-          expand_tkn = expand_tkn->next;
-        }
-      }
+  int keylen = strlen(name) + 1;
+  char *key = calloc(keylen + 1, sizeof(char));
+  key[0] = is_curdir ? '"' : '<';
+  strcpy(key + 1, name);
 
-      define_macro(name, is_objlike, expand_tkn, head.next);
-      continue;
-    }
+  char *path = hashmap_nget(&resolved_includes, key, keylen);
+  if (path != NULL) {
+    token_stats.resolve_hits++;
+    free(key);
+    return path;
+  }
 
-    if (equal(tkn->next->next, "undef")) {
-      Token *expand_tkn = tkn->next->next->next, *tail;
-      ignore_to_newline(expand_tkn, &tail);
-      tkn->next = tail->next;
-      tail->next = NULL;
+  IncludePath curdir = {.path = cur_dir};
+  for (IncludePath *ipath = is_curdir ? &curdir : include_paths; ipath != NULL; ipath = ipath->next) {
+    int len = snprintf(NULL, 0, "%s/%s", ipath->path, name);
+    path = calloc(len + 1, sizeof(char));
+    sprintf(path, "%s/%s", ipath->path, name);
 
-      expand_tkn = delete_pp_token(expand_tkn);
-      undefine_macro(get_ident(expand_tkn));
+    if (hashmap_nget(&missing_includes, path, len) != NULL) {
+      free(path);
       continue;
     }
 
-    if (equal(tkn->next->next, "if") || equal(tkn->next->next, "ifdef") || equal(tkn->next->next, "ifndef")) {
-      Token *expand_tkn = tkn->next, *tail;
-      expand_tkn = expand_if_group(expand_tkn, &tail);
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+      hashmap_ninsert(&resolved_includes, key, keylen, path);
 
-      if (expand_tkn == NULL) {
-        tkn->next = tail;
-      } else {
-        get_tail_token(expand_tkn)->next = tail;
-        tkn->next = expand_tkn;
-      }
-      continue;
+      // As gcc, the dependency is written as it is found from the search directory,
+      // so a file in the current directory is written as the name is spelled.
+      add_dependency(is_curdir ? strdup(name) : path, !is_curdir);
+      return path;
     }
-
-    tkn = tkn->next;
+    hashmap_ninsert(&missing_includes, path, len, path);
   }
 
-  return head->next;
+  free(key);
+  return NULL;
 }
 
-static Token *read_include(char *name, bool allow_curdir) {
-  char path[1024] = {};
-
-  // Find current directory
+// Quoted names are searched in the current directory first.
+// The builtin headers are found before the include paths,
+// so that they are included without the filesystem.
+static Token *read_include(char *name, bool allow_curdir, bool *is_found) {
+  char *path = NULL;
   if (allow_curdir) {
-    add_include_path(getcwd(path, 1024));
+    path = resolve_include(name, true);
   }
+  if (path == NULL) {
+    path = find_builtin_header(name);
+  }
+  if (path == NULL) {
+    path = resolve_include(name, false);
+  }
+  if (path == NULL) {
+    *is_found = false;
+    return NULL;
+  }
+  return read_include_path(path, is_found);
+}
 
-  // Find absolute path
-  FILE *fp = NULL;
-  for (IncludePath *ipath = include_paths; ipath != NULL; ipath = ipath->next) {
-    sprintf(path, "%s/%s", ipath->path, name);
+// Replace "#include" line with the tokens of the included file,
+// and tkn is '#' of the directive.
+static Token *include_file(Token *tkn) {
+  Token *rest;
+  cut_line(tkn, &rest);
+  Token *inc_tkn = tkn->next->next;
+  if (inc_tkn == NULL) {
+    errorf_tkn(ER_COMPILE, tkn->next, "Expected a file name");
+  }
+
+  File *file = tkn->file;
+  char *head_loc = inc_tkn->loc;
+  char *name = inc_tkn->loc + inc_tkn->len;
+  bool allow_curdir = true;
+
+  if (equal_id(inc_tkn, PN_LT)) {
+    allow_curdir = false;
+    inc_tkn = inc_tkn->next;
 
-    if ((fp = fopen(path, "r")) != NULL) {
-      break;
+    while (inc_tkn != NULL && !equal_id(inc_tkn, PN_GT)) {
+      inc_tkn = inc_tkn->next;
+    }
+    if (inc_tkn == NULL) {
+      errorf_tkn(ER_COMPILE, tkn->next, "Expected '>'");
     }
+    name = strndup(name, inc_tkn->loc - name);
   }
 
-  if (allow_curdir) {
-    include_paths = include_paths->next;
+  if (inc_tkn->kind == TK_STR) {
+    name = inc_tkn->lit->strlit;
   }
 
-  if (fp == NULL) {
-    return NULL;
+  bool is_found;
+  Token *head = read_include(name, allow_curdir, &is_found);
+  if (!is_found) {
+    errorf_at(ER_COMPILE, file, head_loc, inc_tkn->loc + inc_tkn->len - head_loc, "Cannot include this file");
   }
 
-  fclose(fp);
+  if (head == NULL) {
+    return rest;
+  }
+  get_tail_token(head)->next = rest;
+  return head;
+}
 
-  return tokenize_file(read_file(path));
+// "#pragma once" prevents the file from being included again.
+// Other pragmas are ignored.
+static void pragma_directive(Token *tkn) {
+  Token *expand_tkn = tkn->next->next;
+  if (expand_tkn != NULL && equal(expand_tkn, "once")) {
+    get_include_file(tkn->file->name)->is_once = true;
+  }
 }
 
-static Token *expand_include(Token *head) {
-  Token *tkn = calloc(1, sizeof(Token));
-  tkn->next = head;
-  head = tkn;
+// Preprocess the token next to tkn, where tkn is the last preprocessed token.
+// Return the next token if it is done, or tkn if the token has been replaced
+// by the expansion of a macro or a directive, which needs to be preprocessed again.
+static Token *expand_next(Token *tkn) {
+  Macro *macro;
+  if (tkn->next->kind == TK_IDENT && (macro = find_macro(tkn->next)) != NULL &&
+      !hideset_contains(tkn->next->hideset, tkn->next->atom)) {
+    Token *ref_tkn = tkn->next;
+    Token *rest = ref_tkn->next;
+
+    // The literal of a constant macro is shared, and the token refers to
+    // the invocation itself. It is never expanded again, so it is not rescanned.
+    if (is_const_macro(macro)) {
+      Token *const_tkn = copy_token(macro->expand_tkn);
+      const_tkn->ref_tkn = ref_tkn;
+      const_tkn->hideset = ref_tkn->hideset;
+      const_tkn->has_space = ref_tkn->has_space;
+      const_tkn->next = rest;
+      token_stats.const_macros++;
+      return tkn->next = const_tkn;
+    }
 
-  while (!is_eof(tkn->next) && !is_eof(tkn->next->next)) {
-    if (!(equal(tkn->next, "#") && equal(tkn->next->next, "include"))) {
-      tkn = tkn->next;
-      continue;
+    MacroActual *actuals = NULL;
+    Hideset *hs = ref_tkn->hideset;
+
+    // The hideset of a function-like macro expansion is the intersection of
+    // the hidesets of the macro name and ')', as in Prosser's algorithm.
+    if (!macro->is_objlike) {
+      if (rest == NULL || is_eof(rest) || !equal_id(rest, PN_LPAREN)) {
+        return tkn->next;
+      }
+
+      Token *rparen;
+      actuals = read_macro_args(macro, rest, &rparen);
+      hs = hideset_intersection(hs, rparen->hideset);
+      rest = rparen->next;
     }
+    hs = new_hideset(ref_tkn->atom, hs);
 
-    Token *inc_tkn = tkn->next->next->next;
-    consume_pp_space(inc_tkn, &inc_tkn, 0);
+    // The expansion is rescanned with the rest of the tokens.
+    Token *tail;
+    Token *expand_tkn = subst_macro(macro, actuals, ref_tkn, hs, &tail);
+    if (expand_tkn != NULL) {
+      tail->next = rest;
+      tkn->next = expand_tkn;
+    } else {
+      tkn->next = rest;
+    }
+    return tkn;
+  }
 
-    File *file = tkn->next->file;
-    char *head_loc = inc_tkn->loc;
-    char *name = inc_tkn->loc + inc_tkn->len;
-    bool allow_curdir = true;
+  if (!tkn->next->at_bol || !equal_id(tkn->next, PN_HASH) || is_line_end(tkn->next->next)) {
+    return tkn->next;
+  }
 
-    if (equal(inc_tkn, "<")) {
-      allow_curdir = false;
-      inc_tkn = inc_tkn->next;
+  if (is_directive(tkn->next, "define")) {
+    Token *directive = tkn->next;
+    cut_line(directive, &(tkn->next));
+
+    Token *expand_tkn = directive->next->next;
+    if (expand_tkn == NULL) {
+      errorf_tkn(ER_COMPILE, directive->next, "Expected a macro name");
+    }
+
+    char *name = get_ident(expand_tkn);
+    bool is_objlike = true;
+    expand_tkn = expand_tkn->next;
+
+    MacroArg head = {};
+    MacroArg *cur = &head;
 
-      while (!equal(inc_tkn, ">")) {
-        inc_tkn = inc_tkn->next;
+    // The macro is function-like only if '(' follows the name without spaces.
+    if (expand_tkn != NULL && !expand_tkn->has_space && consume_id(expand_tkn, &expand_tkn, PN_LPAREN)) {
+      is_objlike = false;
+
+      while (!consume_id(expand_tkn, &expand_tkn, PN_RPAREN)) {
+        if (cur != &head) {
+          expand_tkn = skip_id(expand_tkn, PN_COMMA);
+        }
+
+        cur->next = calloc(1, sizeof(MacroArg));
+        cur = cur->next;
+
+        if (equal_id(expand_tkn, PN_DOT)) {
+          for (int i = 0; i < 3; i++) {
+            expand_tkn = skip_id(expand_tkn, PN_DOT);
+          }
+          cur->name = intern_atom("__VA_ARGS__", 11)->name;
+          expand_tkn = skip_id(expand_tkn, PN_RPAREN);
+          break;
+        }
+
+        cur->name = get_ident(expand_tkn);
+        expand_tkn = expand_tkn->next;
       }
-      name = erase_bslash_str(name, inc_tkn->next->loc - name - 1);
     }
 
-    if (inc_tkn->kind == TK_STR) {
-      name = inc_tkn->strlit;
+    define_macro(name, is_objlike, expand_tkn, head.next);
+    return tkn;
+  }
+
+  if (is_directive(tkn->next, "undef")) {
+    Token *directive = tkn->next;
+    cut_line(directive, &(tkn->next));
+
+    Token *expand_tkn = directive->next->next;
+    if (expand_tkn == NULL) {
+      errorf_tkn(ER_COMPILE, directive->next, "Expected a macro name");
     }
-    inc_tkn = inc_tkn->next;
+    undefine_macro(get_atom(expand_tkn));
+    return tkn;
+  }
+
+  if (is_directive(tkn->next, "include")) {
+    tkn->next = include_file(tkn->next);
+    return tkn;
+  }
 
-    tkn->next = read_include(name, allow_curdir);
-    if (tkn->next == NULL) {
-      errorf_at(ER_COMPILE, file, head_loc, inc_tkn->loc - head_loc, "Cannot include this file");
+  if (is_directive(tkn->next, "pragma")) {
+    Token *directive = tkn->next;
+    cut_line(directive, &(tkn->next));
+    pragma_directive(directive);
+    return tkn;
+  }
+
+  if (is_directive(tkn->next, "if") || is_directive(tkn->next, "ifdef") || is_directive(tkn->next, "ifndef")) {
+    Token *expand_tkn = tkn->next, *tail;
+    expand_tkn = expand_if_group(expand_tkn, &tail);
+
+    if (expand_tkn == NULL) {
+      tkn->next = tail;
+    } else {
+      get_tail_token(expand_tkn)->next = tail;
+      tkn->next = expand_tkn;
     }
+    return tkn;
+  }
+
+  return tkn->next;
+}
+
+static Token *expand_preprocess(Token *head) {
+  Token *tkn = calloc(1, sizeof(Token));
+  tkn->next = head;
+  head = tkn;
 
-    tkn->next = concat_separate_ident_token(tkn->next);
-    get_tail_token(tkn->next)->next = inc_tkn->next;
+  while (tkn->next != NULL && !is_eof(tkn->next)) {
+    tkn = expand_next(tkn);
   }
 
   return head->next;
 }
 
 Token *preprocess(Token *tkn) {
-  tkn = concat_separate_ident_token(tkn);
-  tkn = expand_include(tkn);
-  tkn = expand_preprocess(tkn);
-  tkn = delete_pp_token(tkn);
-  return tkn;
+  return expand_preprocess(tkn);
+}
+
+// The tokens up to pp_cursor have been preprocessed, and the rest are
+// preprocessed one by one when the parser reads them by next_token.
+static Token *pp_cursor;
+
+// Start preprocessing the tokens after prev on demand,
+// and return the first preprocessed token.
+Token *preprocess_stream(Token *prev) {
+  pp_cursor = prev;
+  return next_token(prev);
+}
+
+// Return the token next to tkn, preprocessing it if it has not been yet.
+Token *next_token(Token *tkn) {
+  while (tkn == pp_cursor && tkn->next != NULL && !is_eof(tkn->next)) {
+    pp_cursor = expand_next(tkn);
+  }
+  return tkn->next;
 }
 
@@ -0,0 +1,171 @@
+// Fast scanning of the source for the lexer.
+//
+// The long runs in the source, such as comments, string literals and
+// identifiers, are scanned 16 or 32 bytes at a time with SSE2 or AVX2.
+// The implementation is chosen by cpuid when the lexer is initialized.
+//
+// The vector loads are aligned, so they never cross a page boundary
+// and do not fault even if they read past the terminating '\0'.
+
+#include "token/tokenize.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+static char *find_char_scalar(char *ptr, char c1, char c2, char c3) {
+  while (*ptr != '\0' && *ptr != c1 && *ptr != c2 && *ptr != c3) {
+    ptr++;
+  }
+  return ptr;
+}
+
+static bool is_ident_byte(char c, bool allow_dot) {
+  return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') ||
+         c == '_' || (allow_dot && c == '.');
+}
+
+static char *skip_ident_scalar(char *ptr, bool allow_dot) {
+  while (is_ident_byte(*ptr, allow_dot)) {
+    ptr++;
+  }
+  return ptr;
+}
+
+#if defined(__x86_64__)
+
+// Return the mask of bytes which are c1, c2, c3 or '\0'.
+static inline unsigned find_mask_sse2(__m128i v, char c1, char c2, char c3) {
+  __m128i eq = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+  eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, _mm_set1_epi8(c1)));
+  eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, _mm_set1_epi8(c2)));
+  eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, _mm_set1_epi8(c3)));
+  return _mm_movemask_epi8(eq);
+}
+
+// Return the mask of bytes which are in [lo, hi].
+// Bytes over 0x7f are negative, so they are never in the range.
+static inline __m128i range_sse2(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+}
+
+static inline unsigned ident_mask_sse2(__m128i v, bool allow_dot) {
+  __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+  m = _mm_or_si128(m, range_sse2(v, 'a', 'z'));
+  m = _mm_or_si128(m, range_sse2(v, 'A', 'Z'));
+  m = _mm_or_si128(m, range_sse2(v, '0', '9'));
+  if (allow_dot) {
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+  }
+  return _mm_movemask_epi8(m);
+}
+
+static char *find_char_sse2(char *ptr, char c1, char c2, char c3) {
+  int offset = (uintptr_t)ptr & 15;
+  char *block = ptr - offset;
+
+  unsigned mask = find_mask_sse2(_mm_load_si128((__m128i *)block), c1, c2, c3) & (0xffffu << offset);
+  while (mask == 0) {
+    block += 16;
+    mask = find_mask_sse2(_mm_load_si128((__m128i *)block), c1, c2, c3);
+  }
+  return block + __builtin_ctz(mask);
+}
+
+static char *skip_ident_sse2(char *ptr, bool allow_dot) {
+  int offset = (uintptr_t)ptr & 15;
+  char *block = ptr - offset;
+
+  unsigned mask = ~ident_mask_sse2(_mm_load_si128((__m128i *)block), allow_dot) & (0xffffu << offset);
+  while (mask == 0) {
+    block += 16;
+    mask = ~ident_mask_sse2(_mm_load_si128((__m128i *)block), allow_dot) & 0xffffu;
+  }
+  return block + __builtin_ctz(mask);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline unsigned find_mask_avx2(__m256i v, char c1, char c2, char c3) {
+  __m256i eq = _mm256_cmpeq_epi8(v, _mm256_setzero_si256());
+  eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c1)));
+  eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c2)));
+  eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c3)));
+  return _mm256_movemask_epi8(eq);
+}
+
+AVX2 static inline __m256i range_avx2(__m256i v, char lo, char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+AVX2 static inline unsigned ident_mask_avx2(__m256i v, bool allow_dot) {
+  __m256i m = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+  m = _mm256_or_si256(m, range_avx2(v, 'a', 'z'));
+  m = _mm256_or_si256(m, range_avx2(v, 'A', 'Z'));
+  m = _mm256_or_si256(m, range_avx2(v, '0', '9'));
+  if (allow_dot) {
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+  }
+  return _mm256_movemask_epi8(m);
+}
+
+AVX2 static char *find_char_avx2(char *ptr, char c1, char c2, char c3) {
+  int offset = (uintptr_t)ptr & 31;
+  char *block = ptr - offset;
+
+  unsigned mask = find_mask_avx2(_mm256_load_si256((__m256i *)block), c1, c2, c3) & (0xffffffffu << offset);
+  while (mask == 0) {
+    block += 32;
+    mask = find_mask_avx2(_mm256_load_si256((__m256i *)block), c1, c2, c3);
+  }
+  return block + __builtin_ctz(mask);
+}
+
+AVX2 static char *skip_ident_avx2(char *ptr, bool allow_dot) {
+  int offset = (uintptr_t)ptr & 31;
+  char *block = ptr - offset;
+
+  unsigned mask = ~ident_mask_avx2(_mm256_load_si256((__m256i *)block), allow_dot) & (0xffffffffu << offset);
+  while (mask == 0) {
+    block += 32;
+    mask = ~ident_mask_avx2(_mm256_load_si256((__m256i *)block), allow_dot);
+  }
+  return block + __builtin_ctz(mask);
+}
+
+#undef AVX2
+
+#endif
+
+static char *(*find_char_impl)(char *ptr, char c1, char c2, char c3) = find_char_scalar;
+static char *(*skip_ident_impl)(char *ptr, bool allow_dot) = skip_ident_scalar;
+
+void init_scan() {
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    find_char_impl = find_char_avx2;
+    skip_ident_impl = skip_ident_avx2;
+    return;
+  }
+
+  // SSE2 is always available on x86-64.
+  find_char_impl = find_char_sse2;
+  skip_ident_impl = skip_ident_sse2;
+#endif
+}
+
+// Return the first c1, c2, c3 or '\0' from ptr.
+char *find_char(char *ptr, char c1, char c2, char c3) {
+  return find_char_impl(ptr, c1, c2, c3);
+}
+
+// Return the end of the run of identifier characters from ptr.
+// If allow_dot is true, '.' is also in the run to read numbers.
+char *skip_ident(char *ptr, bool allow_dot) {
+  return skip_ident_impl(ptr, allow_dot);
+}
@@ -13,6 +13,22 @@
 #include <strings.h>
 
 static File *current_file;
+static char *token_id_str[ID_END];
+
+TokenStats token_stats;
+
+void print_token_stats() {
+  fprintf(stderr, "lexed bytes: %ld\n", token_stats.lexed_bytes);
+  fprintf(stderr, "lexed tokens: %ld\n", token_stats.lexed_tokens);
+  fprintf(stderr, "allocated tokens: %ld (%zu bytes each)\n", token_stats.tokens, sizeof(Token));
+  fprintf(stderr, "allocated literals: %ld (%zu bytes each)\n", token_stats.literals, sizeof(TokenLiteral));
+  fprintf(stderr, "include cache hits: %ld\n", token_stats.cache_hits);
+  fprintf(stderr, "include cache misses: %ld\n", token_stats.cache_misses);
+  fprintf(stderr, "include guard skips: %ld\n", token_stats.guard_skips);
+  fprintf(stderr, "include path cache hits: %ld\n", token_stats.resolve_hits);
+  fprintf(stderr, "skipped group bytes: %ld\n", token_stats.skipped_bytes);
+  fprintf(stderr, "constant macro expansions: %ld\n", token_stats.const_macros);
+}
 
 void errorf_tkn(ERROR_TYPE type, Token *tkn, char *fmt, ...) {
   va_list ap;
@@ -25,13 +41,39 @@ void errorf_tkn(ERROR_TYPE type, Token *tkn, char *fmt, ...) {
   verrorf_at(type, tkn->file, tkn->loc, tkn->len, fmt, ap);
 }
 
+// The parser and the preprocessor compare punctuators and keywords by their IDs
+// with equal_id, consume_id and skip_id, so that the spelling is not looked up.
+bool equal_id(Token *tkn, TokenId id) {
+  if (tkn->kind == TK_EOF) {
+    errorf_tkn(ER_COMPILE, tkn, "Reached EOF");
+  }
+  return tkn->id == id;
+}
+
+bool consume_id(Token *tkn, Token **end_tkn, TokenId id) {
+  if (equal_id(tkn, id)) {
+    *end_tkn = next_token(tkn);
+    return true;
+  }
+  *end_tkn = tkn;
+  return false;
+}
+
+Token *skip_id(Token *tkn, TokenId id) {
+  if (!equal_id(tkn, id)) {
+    errorf_tkn(ER_COMPILE, tkn, "%s is expected to be here.", token_id_str[id]);
+  }
+  return next_token(tkn);
+}
+
+// The other names such as directive names are compared by their spellings.
+// Punctuators and keywords should be compared by equal_id instead.
 bool equal(Token *tkn, char *op) {
   if (tkn->kind == TK_EOF) {
     errorf_tkn(ER_COMPILE, tkn, "Reached EOF");
   }
 
-  char *str = erase_bslash_str(tkn->loc, tkn->len);
-  return strcmp(str, op) == 0;
+  return tkn->len == strlen(op) && memcmp(tkn->loc, op, tkn->len) == 0;
 }
 
 // If the token cannot be consumed, false is return value.
@@ -39,7 +81,7 @@ bool equal(Token *tkn, char *op) {
 // will point to the next token.
 bool consume(Token *tkn, Token **end_tkn, char *op) {
   if (equal(tkn, op)) {
-    *end_tkn = tkn->next;
+    *end_tkn = next_token(tkn);
     return true;
   }
   *end_tkn = tkn;
@@ -50,7 +92,7 @@ Token *skip(Token *tkn, char *op) {
   if (!equal(tkn, op)) {
     errorf_tkn(ER_COMPILE, tkn, "%s is expected to be here.", op);
   }
-  return tkn->next;
+  return next_token(tkn);
 }
 
 bool is_eof(Token *tkn) {
@@ -60,21 +102,30 @@ bool is_eof(Token *tkn) {
 // The file variable contains information about the file
 // in which the tokenize_file function was executed.
 Token *new_token(TokenKind kind, char *loc, int len) {
-  Token *tkn = calloc(1, sizeof(Token));
+  Token *tkn = arena_calloc(&token_arena, 1, sizeof(Token));
   tkn->kind = kind;
   tkn->file = current_file;
   tkn->loc = loc;
   tkn->len = len;
+  token_stats.tokens++;
   return tkn;
 }
 
+// The literal of the copied token is shared with the original token.
 Token *copy_token(Token *tkn) {
-  Token *cpy = calloc(1, sizeof(Token));
+  Token *cpy = arena_calloc(&token_arena, 1, sizeof(Token));
   memcpy(cpy, tkn, sizeof(Token));
-
+  cpy->next = NULL;
+  token_stats.tokens++;
   return cpy;
 }
 
+TokenLiteral *new_literal(Token *tkn) {
+  tkn->lit = arena_calloc(&token_arena, 1, sizeof(TokenLiteral));
+  token_stats.literals++;
+  return tkn->lit;
+}
+
 static bool streq(char *ptr, char *eq) {
   return strncmp(ptr, eq, strlen(eq)) == 0;
 }
@@ -83,23 +134,192 @@ static bool strcaseeq(char *ptr, char *eq) {
   return strncasecmp(ptr, eq, strlen(eq)) == 0;
 }
 
-static bool str_check(char *top_str, char *comp_str) {
-  int comp_len = strlen(comp_str);
-  return strncmp(top_str, comp_str, comp_len) == 0 && !isident(*(top_str + comp_len));
+static char *token_id_str[ID_END] = {
+  [PN_LPAREN] = "(",       [PN_RPAREN] = ")",      [PN_SEMICOLON] = ";",
+  [PN_LBRACE] = "{",       [PN_RBRACE] = "}",      [PN_LBRACKET] = "[",
+  [PN_RBRACKET] = "]",     [PN_DOT] = ".",         [PN_ARROW] = "->",
+  [PN_SHL_ASSIGN] = "<<=", [PN_SHL] = "<<",        [PN_LE] = "<=",
+  [PN_LT] = "<",           [PN_SHR_ASSIGN] = ">>=", [PN_SHR] = ">>",
+  [PN_GE] = ">=",          [PN_GT] = ">",          [PN_EQ] = "==",
+  [PN_NE] = "!=",          [PN_ASSIGN] = "=",      [PN_INC] = "++",
+  [PN_ADD_ASSIGN] = "+=",  [PN_ADD] = "+",         [PN_DEC] = "--",
+  [PN_SUB_ASSIGN] = "-=",  [PN_SUB] = "-",         [PN_MUL_ASSIGN] = "*=",
+  [PN_MUL] = "*",          [PN_DIV_ASSIGN] = "/=", [PN_DIV] = "/",
+  [PN_MOD_ASSIGN] = "%=",  [PN_MOD] = "%",         [PN_AND_ASSIGN] = "&=",
+  [PN_LOGAND] = "&&",      [PN_AND] = "&",         [PN_OR_ASSIGN] = "|=",
+  [PN_LOGOR] = "||",       [PN_OR] = "|",          [PN_XOR_ASSIGN] = "^=",
+  [PN_XOR] = "^",          [PN_QUESTION] = "?",    [PN_COLON] = ":",
+  [PN_COMMA] = ",",        [PN_NOT] = "!",         [PN_TILDE] = "~",
+  [PN_HASHHASH] = "##",    [PN_HASH] = "#",
+
+  [KW_RETURN] = "return",     [KW_IF] = "if",             [KW_ELSE] = "else",
+  [KW_FOR] = "for",           [KW_DO] = "do",             [KW_WHILE] = "while",
+  [KW_BREAK] = "break",       [KW_CONTINUE] = "continue", [KW_SWITCH] = "switch",
+  [KW_CASE] = "case",         [KW_DEFAULT] = "default",   [KW_GOTO] = "goto",
+  [KW_SIZEOF] = "sizeof",     [KW_ALIGNOF] = "_Alignof",  [KW_SIGNED] = "signed",
+  [KW_UNSIGNED] = "unsigned", [KW_VOID] = "void",         [KW_BOOL] = "_Bool",
+  [KW_CHAR] = "char",         [KW_SHORT] = "short",       [KW_INT] = "int",
+  [KW_LONG] = "long",         [KW_FLOAT] = "float",       [KW_DOUBLE] = "double",
+  [KW_ENUM] = "enum",         [KW_STRUCT] = "struct",     [KW_UNION] = "union",
+  [KW_AUTO] = "auto",         [KW_CONST] = "const",       [KW_STATIC] = "static",
+  [KW_TYPEDEF] = "typedef",
+};
+
+static int token_id_len[ID_END];
+
+// The first byte of a token decides how the rest of it is read,
+// so tokenize_str dispatches on the class of the first byte.
+typedef enum {
+  CH_OTHER,   // Cannot start a token
+  CH_SPACE,   // White space
+  CH_DIGIT,   // Numerical literal
+  CH_IDENT,   // Identifier or keyword
+  CH_PUNCT,   // Punctuator
+  CH_SLASH,   // Comment or punctuator
+  CH_QUOTE,   // Char literal
+  CH_DQUOTE,  // String literal
+} CharClass;
+
+static uint8_t char_class[256];
+static bool is_ident_char[256];
+
+// Punctuators are recognized by a DFA which is built from token_id_str.
+// Each state has a transition for every character that appears in a punctuator,
+// and the longest accepted prefix becomes the token.
+#define PUNCT_MAX_STATE 64
+#define PUNCT_MAX_CHAR 32
+
+static uint8_t punct_char_idx[256];  // Zero if the character is not in any punctuator
+static uint8_t punct_dfa[PUNCT_MAX_STATE][PUNCT_MAX_CHAR];
+static TokenId punct_accept[PUNCT_MAX_STATE];
+
+// Keywords are looked up by a perfect hash of the length, the first two characters
+// and the last character. init_lexer checks that no two keywords collide.
+#define KEYWORD_TABLE_SIZE 64
+#define KEYWORD_MIN_LEN 2
+#define KEYWORD_MAX_LEN 8
+
+static TokenId keyword_table[KEYWORD_TABLE_SIZE];
+
+static bool is_lexer_ready;
+
+static int keyword_hash(char *ptr, int len) {
+  unsigned char *str = (unsigned char *)ptr;
+  return (len + 7 * str[0] + str[1] + 3 * str[len - 1]) & (KEYWORD_TABLE_SIZE - 1);
 }
 
-static char *permit_panct[] = {
-    "(",   ")",  ";",  "{",  "}",  "[",  "]",  ".", "->", "<<=", "<<", "<=", "<",
-    ">>=", ">>", ">=", ">",  "==", "!=", "=",  "++",  "+=", "+",  "--",
-    "-=",  "-",  "*=", "*",  "/=", "/",  "%=", "%",   "&=", "&&", "&",
-    "|=",  "||", "|",  "^=", "^",  "?",  ":",  ",",   "!",  "~", ":", "##", "#"};
+static void init_lexer() {
+  init_scan();
+
+  for (int c = 0; c < 256; c++) {
+    if (isspace(c)) {
+      char_class[c] = CH_SPACE;
+    } else if (isdigit(c)) {
+      char_class[c] = CH_DIGIT;
+    } else if (isalpha(c) || c == '_') {
+      char_class[c] = CH_IDENT;
+    }
+    is_ident_char[c] = isident(c);
+  }
+  char_class['/'] = CH_SLASH;
+  char_class['\''] = CH_QUOTE;
+  char_class['"'] = CH_DQUOTE;
+
+  int state_cnt = 1, char_cnt = 1;
+  for (TokenId id = PN_LPAREN; id <= PN_HASH; id++) {
+    int state = 0;
+    for (unsigned char *ptr = (unsigned char *)token_id_str[id]; *ptr != '\0'; ptr++) {
+      if (punct_char_idx[*ptr] == 0) {
+        if (char_cnt == PUNCT_MAX_CHAR) {
+          errorf(ER_INTERNAL, "Too many punctuator characters");
+        }
+        punct_char_idx[*ptr] = char_cnt++;
+      }
 
-static char *permit_keywords[] = {
-  "return", "if", "else", "for", "do", "while", "break", "continue",
-  "switch", "case", "default", "goto", "sizeof", "_Alignof",
-  "signed", "unsigned", "void", "_Bool", "char", "short", "int",
-  "long", "float", "double", "enum", "struct", "union",
-  "auto", "const", "static", "typedef"};
+      if (char_class[*ptr] == CH_OTHER) {
+        char_class[*ptr] = CH_PUNCT;
+      }
+
+      uint8_t *next = &punct_dfa[state][punct_char_idx[*ptr]];
+      if (*next == 0) {
+        if (state_cnt == PUNCT_MAX_STATE) {
+          errorf(ER_INTERNAL, "Too many punctuator states");
+        }
+        *next = state_cnt++;
+      }
+      state = *next;
+    }
+    punct_accept[state] = id;
+  }
+
+  for (TokenId id = PN_LPAREN; id < ID_END; id++) {
+    token_id_len[id] = strlen(token_id_str[id]);
+  }
+
+  for (TokenId id = KW_RETURN; id <= KW_TYPEDEF; id++) {
+    int hash = keyword_hash(token_id_str[id], token_id_len[id]);
+    if (keyword_table[hash] != ID_NONE) {
+      errorf(ER_INTERNAL, "Keyword hash collision between %s and %s",
+          token_id_str[keyword_table[hash]], token_id_str[id]);
+    }
+    keyword_table[hash] = id;
+  }
+
+  is_lexer_ready = true;
+}
+
+// Return the length of the longest punctuator at the beginning of ptr,
+// or zero if there is no punctuator.
+static int read_punct(char *ptr, TokenId *id) {
+  int state = 0, len = 0, accept_len = 0;
+
+  while (true) {
+    int idx = punct_char_idx[(unsigned char)ptr[len]];
+    if (idx == 0 || punct_dfa[state][idx] == 0) {
+      break;
+    }
+
+    state = punct_dfa[state][idx];
+    len++;
+    if (punct_accept[state] != ID_NONE) {
+      *id = punct_accept[state];
+      accept_len = len;
+    }
+  }
+
+  return accept_len;
+}
+
+static TokenId find_keyword(char *ptr, int len) {
+  if (len < KEYWORD_MIN_LEN || KEYWORD_MAX_LEN < len) {
+    return ID_NONE;
+  }
+
+  TokenId id = keyword_table[keyword_hash(ptr, len)];
+  if (id != ID_NONE && token_id_len[id] == len && memcmp(ptr, token_id_str[id], len) == 0) {
+    return id;
+  }
+  return ID_NONE;
+}
+
+// Return true if the punctuators are read as other tokens when they are
+// written without a space, such as "+" "+" or "/" "*" which begins a comment.
+bool is_joined_punct(Token *lhs, Token *rhs) {
+  if (lhs->loc[lhs->len - 1] == '/' && (rhs->loc[0] == '*' || rhs->loc[0] == '/')) {
+    return true;
+  }
+
+  // A punctuator is at most 3 characters.
+  char buf[8] = {};
+  memcpy(buf, lhs->loc, lhs->len);
+  memcpy(buf + lhs->len, rhs->loc, rhs->len < 3 ? rhs->len : 3);
+
+  TokenId id = ID_NONE;
+  if (!is_lexer_ready) {
+    init_lexer();
+  }
+  return read_punct(buf, &id) > lhs->len;
+}
 
 static bool convert_tkn_int(Token *tkn) {
   char *ptr = tkn->loc;
@@ -111,8 +331,9 @@ static bool convert_tkn_int(Token *tkn) {
     base = 8;
   }
 
+  // The number is floating-point if it has a fraction or an exponent.
   int64_t val = strtoull(ptr, &ptr, base);
-  if (*ptr == '.') {
+  if (*ptr == '.' || (base != 16 && (*ptr == 'e' || *ptr == 'E')) || (base == 16 && (*ptr == 'p' || *ptr == 'P'))) {
     return false;
   }
 
@@ -167,8 +388,9 @@ static bool convert_tkn_int(Token *tkn) {
   }
 
   tkn->kind = TK_NUM;
-  tkn->val = val;
-  tkn->ty = ty;
+  new_literal(tkn);
+  tkn->lit->val = val;
+  tkn->lit->ty = ty;
   return true;
 }
 
@@ -190,8 +412,9 @@ static void convert_tkn_num(Token *tkn) {
   }
 
   tkn->kind = TK_NUM;
-  tkn->fval = fval;
-  tkn->ty = ty;
+  new_literal(tkn);
+  tkn->lit->fval = fval;
+  tkn->lit->ty = ty;
 }
 
 static char read_escaped_char(char *ptr, char **endptr) {
@@ -210,38 +433,40 @@ static char read_escaped_char(char *ptr, char **endptr) {
 }
 
 static char *strlit_end(char *ptr) {
-  for (; *ptr != '"'; ptr++) {
-    if (*ptr == '\n' || *ptr == '\0') {
+  while (*(ptr = find_char(ptr, '"', '\\', '\n')) != '"') {
+    if (*ptr == '\n' || *ptr == '\0' || ptr[1] == '\n' || ptr[1] == '\0') {
       errorf_at(ER_COMPILE, current_file, ptr, 1, "String must be closed with double quotation marks");
     }
-
-    if (*ptr == '\\') {
-      ptr++;
-    }
+    ptr += 2;
   }
   return ptr;
 }
 
 static Token *read_strlit(char *begin, char **endptr) {
   char *end = strlit_end(begin + 1);
-  char *str = calloc(end - begin, sizeof(char));
+  char *str = arena_calloc(&string_arena, end - begin, sizeof(char));
 
+  // Copy the runs between escape sequences at once.
   int len = 0;
   for (char *ptr = begin + 1; ptr < end;) {
     if (*ptr == '\\') {
       str[len++] = read_escaped_char(ptr + 1, &ptr);
-    } else {
-      str[len++] = *ptr;
-      ptr++;
+      continue;
     }
+
+    char *run_end = find_char(ptr, '\\', '"', '"');
+    memcpy(str + len, ptr, run_end - ptr);
+    len += run_end - ptr;
+    ptr = run_end;
   }
   len++;
   end++;
   *endptr = end;
 
   Token *tkn = new_token(TK_STR, begin, end - begin);
-  tkn->strlit = str;
-  tkn->ty = array_to(ty_i8, len);
+  new_literal(tkn);
+  tkn->lit->strlit = str;
+  tkn->lit->ty = array_to(ty_i8, len);
   return tkn;
 }
 
@@ -263,8 +488,9 @@ static Token *read_charlit(char *begin, char **endptr) {
   *endptr = ptr;
 
   Token *tkn = new_token(TK_NUM, begin, ptr - begin);
-  tkn->val = c;
-  tkn->ty = ty_i8;
+  new_literal(tkn);
+  tkn->lit->val = c;
+  tkn->lit->ty = ty_i8;
   return tkn;
 }
 
@@ -279,123 +505,242 @@ void add_eof_token(Token *head) {
   Token *tail = get_tail_token(head);
   tail->next = new_token(TK_EOF, tail->loc + strlen(tail->loc) - 1, 1);
   tail->next->file = tail->file;
+  tail->next->at_bol = true;
 }
 
-char *get_ident(Token *tkn) {
+// Identifiers are interned when they are tokenized,
+// so get_ident returns the same string for the same name without allocation.
+Atom *get_atom(Token *tkn) {
   if (tkn->kind != TK_IDENT) {
     errorf_tkn(ER_COMPILE, tkn, "Expected an identifier");
   }
-  return erase_bslash_str(tkn->loc, tkn->len);
+  return tkn->atom;
 }
 
-Token *tokenize_str(char *ptr, char *tokenize_end) {
-  Token head;
-  Token *cur = &head;
+char *get_ident(Token *tkn) {
+  return get_atom(tkn)->name;
+}
 
-  while (*ptr != '\0' && ptr != tokenize_end) {
-    // Comment out of line
-    if (streq(ptr, "//")) {
-      while (*ptr != '\n') {
-        ptr++;
-      }
+// Read the name of the directive after '#', and return its length.
+static int read_directive_name(char *ptr, char **name) {
+  while (*ptr == ' ' || *ptr == '\t') {
+    ptr++;
+  }
+
+  *name = ptr;
+  while (is_ident_char[(unsigned char)*ptr]) {
+    ptr++;
+  }
+  return ptr - *name;
+}
+
+static bool is_directive_name(char *name, int len, char *directive) {
+  return len == (int)strlen(directive) && strncmp(name, directive, len) == 0;
+}
+
+// Return true if ptr is the next of '#' which begins a conditional group.
+static bool is_group_begin(char *ptr) {
+  char *name;
+  int len = read_directive_name(ptr, &name);
+  return is_directive_name(name, len, "if") || is_directive_name(name, len, "ifdef") ||
+         is_directive_name(name, len, "ifndef") || is_directive_name(name, len, "elif") ||
+         is_directive_name(name, len, "else");
+}
+
+// Skip the body of a conditional group without tokenization.
+// Only directives, comments and literals are tracked to find the nesting,
+// and the beginning of the line of "#elif", "#else" or "#endif"
+// which ends the group is returned.
+static char *skip_group(char *ptr) {
+  int depth = 0;
+
+  while (*ptr != '\0') {
+    char *line = ptr;
+    while (*ptr == ' ' || *ptr == '\t') {
       ptr++;
-      continue;
     }
 
-    // Comment out of block
-    if (streq(ptr, "/*")) {
-      while (!streq(ptr, "*/")) {
-        ptr++;
+    if (*ptr == '#') {
+      char *name;
+      int len = read_directive_name(ptr + 1, &name);
+      ptr = name + len;
+
+      if (is_directive_name(name, len, "if") || is_directive_name(name, len, "ifdef") ||
+          is_directive_name(name, len, "ifndef")) {
+        depth++;
+      } else if (is_directive_name(name, len, "endif")) {
+        if (depth == 0) {
+          return line;
+        }
+        depth--;
+      } else if (depth == 0 && (is_directive_name(name, len, "elif") || is_directive_name(name, len, "else"))) {
+        return line;
       }
-      ptr += 2;
-      continue;
     }
 
-    // Back slash
-    if (*ptr == '\\') {
-      while (*ptr != '\n') {
-        ptr++;
+    while (*ptr != '\n' && *ptr != '\0') {
+      if (streq(ptr, "//")) {
+        ptr = find_char(ptr, '\n', '\n', '\n');
+        break;
       }
-      ptr++;
-      continue;
-    }
 
-    // Skip space
-    if (isspace(*ptr)) {
-      cur = cur->next = new_token(TK_PP, ptr, 1);
-      ptr++;
-      continue;
-    }
+      if (streq(ptr, "/*")) {
+        char *end = strstr(ptr + 2, "*/");
+        ptr = end != NULL ? end + 2 : ptr + strlen(ptr);
+        continue;
+      }
 
-    // Numerical literal
-    if (isdigit(*ptr)) {
-      char *begin = ptr;
-      while (isalnum(*ptr) || *ptr == '.') {
-        ptr++;
+      // Unterminated literals are allowed in skipped groups.
+      if (*ptr == '"' || *ptr == '\'') {
+        char quote = *ptr++;
+        while (*ptr != quote && *ptr != '\n' && *ptr != '\0') {
+          ptr += (*ptr == '\\' && ptr[1] != '\n' && ptr[1] != '\0') ? 2 : 1;
+        }
+        if (*ptr == quote) {
+          ptr++;
+        }
+        continue;
       }
-      cur = cur->next = new_token(TK_NUM, begin, ptr - begin);
-      convert_tkn_num(cur);
-      continue;
+      ptr++;
     }
 
-    // Char literal
-    if (*ptr == '\'') {
-      cur = cur->next = read_charlit(ptr, &ptr);
-      continue;
+    if (*ptr == '\n') {
+      ptr++;
     }
+  }
+  return ptr;
+}
 
-    // String literal
-    if (*ptr == '"') {
-      cur = cur->next = read_strlit(ptr, &ptr);
-      continue;
-    }
+Token *tokenize_str(char *ptr, char *tokenize_end) {
+  if (!is_lexer_ready) {
+    init_lexer();
+  }
 
-    bool check = false;
+  Token head;
+  Token *cur = &head;
+  char *start = ptr;
+  int64_t group_bytes = 0;
 
-    // Check punctuators
-    for (int i = 0; i < sizeof(permit_panct) / sizeof(char *); i++) {
-      int panct_len = strlen(permit_panct[i]);
-      if (strncmp(ptr, permit_panct[i], panct_len) == 0) {
-        cur = cur->next = new_token(TK_PUNCT, ptr, panct_len);
-        ptr += panct_len;
-        check = true;
-        break;
-      }
-    }
+  // White spaces and comments are not tokens,
+  // and they are recorded in the at_bol and has_space of the next token.
+  bool is_bol = true;
+  bool has_space = false;
 
-    if (check) {
-      continue;
+  // The body of a conditional group is not tokenized here,
+  // and it is stored in a TK_GROUP token to be tokenized if the group is taken.
+  bool has_group = false;
+
+  while (*ptr != '\0' && ptr != tokenize_end) {
+    if (*ptr == '#' && is_bol) {
+      has_group = is_group_begin(ptr + 1);
     }
 
-    // Check keywords
-    for (int i = 0; i < sizeof(permit_keywords) / sizeof(char *); ++i) {
-      int keyword_len = strlen(permit_keywords[i]);
-      if (strncmp(ptr, permit_keywords[i], keyword_len) == 0 && !isident(*(ptr + keyword_len))) {
-        cur = cur->next = new_token(TK_KEYWORD, ptr, keyword_len);
-        ptr += keyword_len;
-        check = true;
+    Token *tkn = NULL;
+    switch (char_class[(unsigned char)*ptr]) {
+      case CH_SPACE:
+        has_space = true;
+        if (*ptr++ != '\n') {
+          continue;
+        }
+
+        is_bol = true;
+        if (has_group) {
+          has_group = false;
+          char *end = skip_group(ptr);
+          if (tokenize_end != NULL && end > tokenize_end) {
+            end = tokenize_end;
+          }
+
+          if (end != ptr) {
+            cur = cur->next = new_token(TK_GROUP, ptr, end - ptr);
+            cur->at_bol = cur->has_space = true;
+            group_bytes += end - ptr;
+            ptr = end;
+          }
+        }
+        continue;
+      case CH_DIGIT: {
+        char *begin = ptr;
+        ptr = skip_ident(ptr, true);
+
+        // The sign of the exponent such as "1e-5" is a part of the number.
+        while ((*ptr == '+' || *ptr == '-') && strchr("eEpP", ptr[-1]) != NULL) {
+          ptr = skip_ident(ptr + 1, true);
+        }
+        tkn = new_token(TK_NUM, begin, ptr - begin);
+        convert_tkn_num(tkn);
         break;
       }
-    }
-
-    if (check) {
-      continue;
-    }
-
-    if (isident(*ptr) && !isdigit(*ptr)) {
-      int len = 0;
-      while (isident(*ptr)) {
-        ptr++;
-        len++;
+      case CH_IDENT: {
+        char *begin = ptr;
+        ptr = skip_ident(ptr, false);
+
+        TokenId id = find_keyword(begin, ptr - begin);
+        tkn = new_token(id == ID_NONE ? TK_IDENT : TK_KEYWORD, begin, ptr - begin);
+        tkn->id = id;
+        if (id == ID_NONE) {
+          tkn->atom = intern_atom(begin, ptr - begin);
+        }
+        break;
+      }
+      case CH_QUOTE:
+        tkn = read_charlit(ptr, &ptr);
+        break;
+      case CH_DQUOTE:
+        tkn = read_strlit(ptr, &ptr);
+        break;
+      case CH_SLASH:
+        // Comment out of line
+        // The newline is left to end the directive.
+        if (ptr[1] == '/') {
+          ptr = find_char(ptr, '\n', '\n', '\n');
+          has_space = true;
+          continue;
+        }
+
+        // Comment out of block
+        if (ptr[1] == '*') {
+          char *begin = ptr;
+          ptr += 2;
+          while (*(ptr = find_char(ptr, '*', '*', '*')) != '\0' && ptr[1] != '/') {
+            ptr++;
+          }
+
+          if (*ptr == '\0') {
+            errorf_at(ER_TOKENIZE, current_file, begin, 2, "Unterminated comment");
+          }
+          ptr += 2;
+          has_space = true;
+          continue;
+        }
+        // fallthrough
+      case CH_PUNCT: {
+        TokenId id = ID_NONE;
+        int len = read_punct(ptr, &id);
+        if (len == 0) {
+          break;
+        }
+
+        tkn = new_token(TK_PUNCT, ptr, len);
+        tkn->id = id;
+        ptr += len;
+        break;
       }
+    }
 
-      cur = cur->next = new_token(TK_IDENT, ptr - len, len);
-      continue;
+    if (tkn == NULL) {
+      errorf_at(ER_TOKENIZE, current_file, ptr, 1, "Unexpected tokenize");
     }
 
-    errorf_at(ER_TOKENIZE, current_file, ptr, 1, "Unexpected tokenize");
+    tkn->at_bol = is_bol;
+    tkn->has_space = has_space;
+    is_bol = has_space = false;
+    cur = cur->next = tkn;
+    token_stats.lexed_tokens++;
   }
 
+  cur->next = NULL;
+  token_stats.lexed_bytes += ptr - start - group_bytes;
   return head.next;
 }
 
@@ -409,13 +754,41 @@ Token *tokenize_file(File *file) {
   return tkn;
 }
 
+// Tokenize the body of the conditional group which is taken.
+Token *tokenize_group(Token *tkn) {
+  File *store_file = current_file;
+  current_file = tkn->file;
+
+  Token *head = tokenize_str(tkn->loc, tkn->loc + tkn->len);
+
+  current_file = store_file;
+  return head;
+}
+
 // Update source token
-Token *tokenize(char *path) {
+// If pch_path is not NULL, the precompiled header is loaded
+// and its tokens are placed before the tokens of the file.
+Token *tokenize(char *path, char *pch_path) {
   init_macro();
+  Token *pch_tkn = NULL;
+  if (pch_path != NULL) {
+    pch_tkn = load_pch(pch_path);
+  }
+
   File *file = read_file(path);
 
   Token *tkn = tokenize_file(file);
   add_eof_token(tkn);
 
-  return preprocess(tkn);
+  // The tokens are preprocessed while they are parsed.
+  // The tokens of the precompiled header have already been preprocessed.
+  if (pch_tkn == NULL) {
+    Token *head = calloc(1, sizeof(Token));
+    head->next = tkn;
+    return preprocess_stream(head);
+  }
+  Token *tail = get_tail_token(pch_tkn);
+  tail->next = tkn;
+  preprocess_stream(tail);
+  return pch_tkn;
 }
@@ -14,19 +14,125 @@ typedef enum {
   TK_KEYWORD,   // Keywords
   TK_IDENT,     // Ident (etc. variable)
   TK_STR,       // String literal
-  TK_PP,        // Preprocessor Token
+  TK_GROUP,     // Body of a conditional group which is not tokenized yet
   TK_EOF,       // End of File
 } TokenKind;
 
+// Punctuators and keywords are identified by TokenId when they are tokenized,
+// so that we do not need to compare token strings to know what they are.
+typedef enum {
+  ID_NONE,         // Not a punctuator or keyword
+
+  // Punctuators
+  PN_LPAREN,       // "("
+  PN_RPAREN,       // ")"
+  PN_SEMICOLON,    // ";"
+  PN_LBRACE,       // "{"
+  PN_RBRACE,       // "}"
+  PN_LBRACKET,     // "["
+  PN_RBRACKET,     // "]"
+  PN_DOT,          // "."
+  PN_ARROW,        // "->"
+  PN_SHL_ASSIGN,   // "<<="
+  PN_SHL,          // "<<"
+  PN_LE,           // "<="
+  PN_LT,           // "<"
+  PN_SHR_ASSIGN,   // ">>="
+  PN_SHR,          // ">>"
+  PN_GE,           // ">="
+  PN_GT,           // ">"
+  PN_EQ,           // "=="
+  PN_NE,           // "!="
+  PN_ASSIGN,       // "="
+  PN_INC,          // "++"
+  PN_ADD_ASSIGN,   // "+="
+  PN_ADD,          // "+"
+  PN_DEC,          // "--"
+  PN_SUB_ASSIGN,   // "-="
+  PN_SUB,          // "-"
+  PN_MUL_ASSIGN,   // "*="
+  PN_MUL,          // "*"
+  PN_DIV_ASSIGN,   // "/="
+  PN_DIV,          // "/"
+  PN_MOD_ASSIGN,   // "%="
+  PN_MOD,          // "%"
+  PN_AND_ASSIGN,   // "&="
+  PN_LOGAND,       // "&&"
+  PN_AND,          // "&"
+  PN_OR_ASSIGN,    // "|="
+  PN_LOGOR,        // "||"
+  PN_OR,           // "|"
+  PN_XOR_ASSIGN,   // "^="
+  PN_XOR,          // "^"
+  PN_QUESTION,     // "?"
+  PN_COLON,        // ":"
+  PN_COMMA,        // ","
+  PN_NOT,          // "!"
+  PN_TILDE,        // "~"
+  PN_HASHHASH,     // "##"
+  PN_HASH,         // "#"
+
+  // Keywords
+  KW_RETURN,       // "return"
+  KW_IF,           // "if"
+  KW_ELSE,         // "else"
+  KW_FOR,          // "for"
+  KW_DO,           // "do"
+  KW_WHILE,        // "while"
+  KW_BREAK,        // "break"
+  KW_CONTINUE,     // "continue"
+  KW_SWITCH,       // "switch"
+  KW_CASE,         // "case"
+  KW_DEFAULT,      // "default"
+  KW_GOTO,         // "goto"
+  KW_SIZEOF,       // "sizeof"
+  KW_ALIGNOF,      // "_Alignof"
+  KW_SIGNED,       // "signed"
+  KW_UNSIGNED,     // "unsigned"
+  KW_VOID,         // "void"
+  KW_BOOL,         // "_Bool"
+  KW_CHAR,         // "char"
+  KW_SHORT,        // "short"
+  KW_INT,          // "int"
+  KW_LONG,         // "long"
+  KW_FLOAT,        // "float"
+  KW_DOUBLE,       // "double"
+  KW_ENUM,         // "enum"
+  KW_STRUCT,       // "struct"
+  KW_UNION,        // "union"
+  KW_AUTO,         // "auto"
+  KW_CONST,        // "const"
+  KW_STATIC,       // "static"
+  KW_TYPEDEF,      // "typedef"
+
+  ID_END,
+} TokenId;
+
 typedef struct Token Token;
 
+// Set of macro names which are not expanded in the token any more.
+// The name of a macro is added to the tokens of its expansion,
+// so that the macro is not expanded recursively.
+typedef struct Hideset Hideset;
+struct Hideset {
+  Hideset *next;
+  Atom *name;
+};
+
+// Value of a numerical or string literal.
+// Only literal tokens have it, and copied tokens share it.
+typedef struct {
+  void *ty;          // Type of the literal
+  int64_t val;       // Value if kind is TK_NUM
+  long double fval;  // Floating-value if kind is TK_NUM
+  char *strlit;      // String literal
+} TokenLiteral;
+
 struct Token {
-  TokenKind kind;  // Type of Token
   Token *next;     // Next token
 
   File *file;      // Belong of file
   char *loc;       // Token String
-  int len;         // Token length
 
   // When a macro is expanded,
   // the macro identifier disappears from the token list,
@@ -35,33 +141,139 @@ struct Token {
   // etc., so it is stored in the ref_tkn variable.
   Token *ref_tkn;
 
-  void *ty;          // Type if kind is TK_NUM
-  int64_t val;       // Value if kind is TK_NUM 
-  long double fval;  // Floating-value if kind is TK_NUM
+  Hideset *hideset;  // Macros which must not be expanded in this token
+
+  union {
+    TokenLiteral *lit;  // Literal if kind is TK_NUM or TK_STR
+    Atom *atom;         // Interned name if kind is TK_IDENT
+  };
+  int len;  // Token length
 
-  char *strlit;  // String literal
+  uint8_t kind;  // Type of Token (TokenKind)
+  uint8_t id;    // Punctuator or keyword ID (TokenId)
+
+  // White spaces are not tokens, and they are recorded in the next token.
+  bool at_bol;     // True if the token is at the beginning of a line
+  bool has_space;  // True if the token follows a space or a newline
 };
 
 bool equal(Token *tkn, char *op);
 bool consume(Token *tkn, Token **end_tkn, char *op);
 Token *skip(Token *tkn, char *op);
+bool equal_id(Token *tkn, TokenId id);
+bool consume_id(Token *tkn, Token **end_tkn, TokenId id);
+Token *skip_id(Token *tkn, TokenId id);
 bool is_eof(Token *tkn);
 
 Token *new_token(TokenKind kind, char *loc, int len);
+Token *copy_token(Token *tkn);
+TokenLiteral *new_literal(Token *tkn);
+bool is_joined_punct(Token *lhs, Token *rhs);
 char read_char(char *str, char **end_ptr);
 Token *get_tail_token(Token *tkn);
 void add_eof_token(Token *tkn);
 char *get_ident(Token *tkn);
-Token *tokenize(char *file_name);
+Atom *get_atom(Token *tkn);
+Token *tokenize(char *file_name, char *pch_path);
 Token *tokenize_file(File *file);
+Token *tokenize_group(Token *tkn);
 Token *tokenize_str(char *ptr, char *tokenize_end);
 
 void errorf_tkn(ERROR_TYPE type, Token *tkn, char *fmt, ...);
 
+// Statistics printed by "--stats" option
+typedef struct {
+  int64_t lexed_bytes;   // Bytes read by the lexer
+  int64_t lexed_tokens;  // Tokens made by the lexer
+  int64_t tokens;        // All tokens allocated
+  int64_t literals;      // All literals allocated
+  int64_t cache_hits;    // Included files whose tokens are copied from the cache
+  int64_t cache_misses;  // Included files which are lexed
+  int64_t guard_skips;   // Included files skipped by the include guard or "#pragma once"
+  int64_t resolve_hits;  // Include names resolved from the path cache
+  int64_t skipped_bytes; // Bytes of inactive conditional groups which are not lexed
+  int64_t const_macros;  // Expansions of constant macros which share the literal
+} TokenStats;
+
+extern TokenStats token_stats;
+void print_token_stats();
+
 //
 // preprocess.c
 //
 
+typedef struct MacroArg MacroArg;
+struct MacroArg {
+  char *name;  // Interned name, so it is compared by pointer
+  MacroArg *next;
+};
+
+typedef Token *macro_handler_fn(Token *tkn);
+
+typedef struct {
+  char *name;
+  bool is_objlike;
+
+  Token *expand_tkn;
+  MacroArg *args;
+
+  macro_handler_fn *handler;
+} Macro;
+
+// Information of the file which has been included
+typedef struct {
+  char *guard;   // Name of the include guard macro
+  bool is_once;  // If true, the file has "#pragma once"
+
+  // Tokens of the file are cached to include it again without tokenization.
+  // The cache is valid while the modification time of the file is the same.
+  Token *tkn;
+  int64_t mtime;
+} IncludeFile;
+
+// File which the translation unit depends on, in the order of inclusion
+typedef struct Dependency Dependency;
+struct Dependency {
+  char *path;
+  bool is_system;  // Found in the include paths, not in the current directory
+  Dependency *next;
+};
+
+extern HashMap macros;
+extern HashMap include_files;
+extern Dependency *dependencies;
+
 void init_macro();
 void add_include_path(char *path);
 Token *preprocess(Token *tkn);
+Token *preprocess_stream(Token *prev);
+Token *next_token(Token *tkn);
+
+//
+// pch.c
+//
+
+void emit_pch(char *path, char *pch_path);
+Token *load_pch(char *pch_path);
+
+//
+// output.c
+//
+
+void output_preprocessed(Token *tkn, char *path, bool has_linemarker);
+void output_dependencies(char *path, char *target, char *input_file, bool has_system);
+
+//
+// builtin.c
+//
+
+char *find_builtin_header(char *name);
+File *open_builtin_header(char *path);
+
+//
+// scan.c
+//
+
+void init_scan();
+char *find_char(char *ptr, char c1, char c2, char c3);
+char *skip_ident(char *ptr, bool allow_dot);
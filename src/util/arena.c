@@ -0,0 +1,81 @@
+// Bump-pointer allocator
+//
+// Objects of the compiler are allocated from the arenas instead of calloc.
+// An arena hands out memory from large zero-filled blocks, and never frees
+// the objects one by one. The objects live until the compiler exits,
+// since nodes and types refer to their tokens to report errors even in codegen.
+
+#include "util/util.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+struct ArenaBlock {
+  ArenaBlock *next;
+};
+
+Arena token_arena = {.name = "tokens"};
+Arena ast_arena = {.name = "ast"};
+Arena type_arena = {.name = "types"};
+Arena string_arena = {.name = "strings"};
+
+static void arena_grow(Arena *arena, int64_t size) {
+  int64_t block_size = sizeof(ArenaBlock) + size + 16;
+  if (block_size < ARENA_BLOCK_SIZE) {
+    block_size = ARENA_BLOCK_SIZE;
+  }
+
+  ArenaBlock *block = calloc(1, block_size);
+  if (block == NULL) {
+    errorf(ER_INTERNAL, "Failed to allocate %ld bytes for %s", block_size, arena->name);
+  }
+  block->next = arena->blocks;
+  arena->blocks = block;
+  arena->ptr = (char *)(block + 1);
+  arena->end = (char *)block + block_size;
+  arena->reserved += block_size;
+}
+
+// Allocate zero-filled memory like calloc.
+// The size of a type is a multiple of its alignment, so the memory is aligned
+// to the largest power of two which divides the size, up to 16 bytes.
+void *arena_calloc(Arena *arena, int64_t cnt, int64_t size) {
+  int64_t bytes = cnt * size;
+  uintptr_t align = size & -size;
+  if (align == 0 || align > 16) {
+    align = 16;
+  }
+
+  uintptr_t ptr = ((uintptr_t)arena->ptr + align - 1) & ~(align - 1);
+  if (arena->ptr == NULL || ptr + bytes > (uintptr_t)arena->end) {
+    arena_grow(arena, bytes);
+    ptr = ((uintptr_t)arena->ptr + align - 1) & ~(align - 1);
+  }
+
+  arena->ptr = (char *)(ptr + bytes);
+  arena->allocs++;
+  arena->bytes += bytes;
+  return (void *)ptr;
+}
+
+char *arena_strndup(Arena *arena, char *str, int len) {
+  char *dup = arena_calloc(arena, len + 1, sizeof(char));
+  memcpy(dup, str, len);
+  return dup;
+}
+
+static void print_arena(Arena *arena) {
+  fprintf(stderr, "arena %s: %ld allocations, %ld bytes (%ld bytes reserved)\n", arena->name, arena->allocs,
+          arena->bytes, arena->reserved);
+}
+
+void print_arena_stats() {
+  print_arena(&token_arena);
+  print_arena(&ast_arena);
+  print_arena(&type_arena);
+  print_arena(&string_arena);
+}
@@ -47,39 +47,22 @@ void verrorf_at(ERROR_TYPE type, File *file, char *loc, int underline_len, char
       color = "\x1b[31m\x1b[1m";
   }
 
-  char code[1024] = {};
-  int hloc = 1, wloc = 0;
-
   // Where char location belong line
-  int pass_loc = -1;
-  for (char *now_loc = file->contents; *now_loc != '\0'; now_loc++) {
-    if (now_loc == loc) {
-      pass_loc = 0;
-    }
-
-    if (pass_loc == -1) {
-      wloc++;
-    } else if (pass_loc == 0) {
-      strcat(code, color);
-    } else if (pass_loc == underline_len) {
-      strcat(code, cerase);
-    }
-
-    if (pass_loc != -1) {
-      pass_loc++;
-    }
-
-    strncat(code, now_loc, 1);
-    if (*now_loc == '\n' || *now_loc == '\0') {
-      if (pass_loc != -1) {
-        break;
-      }
-
-      hloc++;
-      wloc = 1;
-      memset(code, 0, 1024);
-    }
+  char *end_loc = get_orig_loc(file, loc + underline_len);
+  loc = get_orig_loc(file, loc);
+
+  int hloc = get_line_no(file, loc);
+  char *line = get_line_begin(file, hloc);
+  char *line_end = strchr(loc, '\n');
+  if (line_end == NULL) {
+    line_end = loc + strlen(loc);
+  }
+  if (end_loc > line_end) {
+    end_loc = line_end;
   }
+  underline_len = end_loc - loc;
+  int wloc = loc - line + 1;
+
   fprintf(stderr, "\x1b[1m%s:%d:%d: ", file->name, hloc, wloc);
 
   switch (type) {
@@ -92,31 +75,21 @@ void verrorf_at(ERROR_TYPE type, File *file, char *loc, int underline_len, char
   vfprintf(stderr, fmt, ap);
 
   // Prine line
-  fprintf(stderr, "\n   %d | %s", hloc, code);
-
-  if (code[strlen(code) - 1] != '\n') {
-    fprintf(stderr, "\n");
-  }
+  fprintf(stderr, "\n   %d | %.*s%s%.*s%s%.*s\n", hloc, (int)(loc - line), line,
+          color, underline_len, loc, cerase, (int)(line_end - end_loc), end_loc);
 
   // Print space of line location print
   int space_len = 4;
   for (int i = hloc; i != 0; i /= 10) {
     space_len++;
   }
+  fprintf(stderr, "%*s|%*s", space_len, "", wloc, "");
 
-  memset(code, 0, 1024);
-  memset(code, ' ', space_len);
-  strcat(code, "|");
-  fprintf(stderr, "%s", code);
-
-  memset(code, 0, 1024);
-  memset(code, ' ', wloc);
-  fprintf(stderr, "%s", code);
-
-  memset(code, '~', underline_len);
-  code[0] = '^';
-  code[underline_len] = '\0';
-  fprintf(stderr, "%s%s%s\n", color, code, cerase);
+  fprintf(stderr, "%s^", color);
+  for (int i = 1; i < underline_len; i++) {
+    fprintf(stderr, "~");
+  }
+  fprintf(stderr, "%s\n", cerase);
 
   if (type != ER_NOTE) {
     exit(1);
@@ -1,47 +1,239 @@
+// MAP_ANONYMOUS is not defined in POSIX.
+#define _DEFAULT_SOURCE
 #include "util/util.h"
 
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// If the backslash is followed by a newline (spaces are allowed between them),
+// return the length of the line splicing. Otherwise, return zero.
+static int splice_len(char *ptr) {
+  char *end = ptr + 1;
+  while (*end == ' ' || *end == '\t') {
+    end++;
+  }
+
+  if (*end != '\n') {
+    return 0;
+  }
+
+  // A newline at the end of file is left, since the contents must end with a newline.
+  if (end[1] == '\0') {
+    return end - ptr;
+  }
+  return end - ptr + 1;
+}
+
+// In the C language, a backslash immediately followed by a newline is deleted
+// before tokenization, so "abc\\\ndef" becomes "abcdef".
+// The contents are copied only if there is a line splicing.
+static void splice_lines(File *file) {
+  char *orig = file->orig_contents;
+  file->contents = orig;
+
+  int cnt = 0;
+  for (char *ptr = strchr(orig, '\\'); ptr != NULL; ptr = strchr(ptr + 1, '\\')) {
+    if (splice_len(ptr) != 0) {
+      cnt++;
+    }
+  }
+
+  if (cnt == 0) {
+    return;
+  }
+
+  char *buf = calloc(strlen(orig) + 1, sizeof(char));
+  file->splice_offset = calloc(cnt, sizeof(int));
+  file->splice_shift = calloc(cnt, sizeof(int));
+
+  int len = 0, shift = 0;
+  for (char *ptr = orig; *ptr != '\0';) {
+    int slen = 0;
+    if (*ptr == '\\' && (slen = splice_len(ptr)) != 0) {
+      shift += slen;
+      file->splice_offset[file->splice_cnt] = len;
+      file->splice_shift[file->splice_cnt] = shift;
+      file->splice_cnt++;
+      ptr += slen;
+      continue;
+    }
+
+    buf[len++] = *ptr++;
+  }
+
+  file->contents = buf;
+}
 
 File *new_file(char *name, char *contents) {
   File *file = calloc(1, sizeof(File));
   file->name = strdup(name);
-  file->contents = contents;
+  file->orig_contents = contents;
+  splice_lines(file);
   return file;
 }
 
-File *read_file(char *path) {
-  FILE *fp;
-  if ((fp = fopen(path, "r")) == NULL) {
-    fprintf(stderr, "Failed to open the file: %s\n", path);
-    exit(1);
+// Return the location in the original contents corresponding to
+// the location in the contents after line splicing.
+char *get_orig_loc(File *file, char *loc) {
+  int offset = loc - file->contents;
+  if (file->splice_cnt == 0 || offset < 0) {
+    return file->orig_contents + offset;
+  }
+
+  // Find the last line splicing at or before the offset.
+  int low = 0, high = file->splice_cnt;
+  while (low < high) {
+    int mid = (low + high) / 2;
+    if (file->splice_offset[mid] <= offset) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  if (low == 0) {
+    return file->orig_contents + offset;
+  }
+  return file->orig_contents + offset + file->splice_shift[low - 1];
+}
+
+static void build_line_offset(File *file) {
+  char *contents = file->orig_contents;
+  char *end = contents + strlen(contents);
+
+  int cnt = 1;
+  for (char *ptr = contents; (ptr = memchr(ptr, '\n', end - ptr)) != NULL; ptr++) {
+    cnt++;
+  }
+
+  file->line_offset = calloc(cnt, sizeof(int));
+  file->line_cnt = 1;
+  for (char *ptr = contents; (ptr = memchr(ptr, '\n', end - ptr)) != NULL; ptr++) {
+    file->line_offset[file->line_cnt++] = ptr + 1 - contents;
+  }
+}
+
+// Return the line number of the location in the original contents.
+// The line is found by binary search, so the file is scanned only once
+// even if many locations are queried.
+int get_line_no(File *file, char *orig_loc) {
+  if (file->line_offset == NULL) {
+    build_line_offset(file);
   }
 
-  char *buf;
-  size_t buflen;
-  FILE *buffp = open_memstream(&buf, &buflen);
+  // Find the last line beginning at or before the location.
+  int offset = orig_loc - file->orig_contents;
+  int low = 0, high = file->line_cnt;
+  while (low < high) {
+    int mid = (low + high) / 2;
+    if (file->line_offset[mid] <= offset) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+// Return the beginning of the line in the original contents.
+char *get_line_begin(File *file, int line_no) {
+  if (file->line_offset == NULL) {
+    build_line_offset(file);
+  }
+  return file->orig_contents + file->line_offset[line_no - 1];
+}
 
-  // Read file
-  while (true) {
-    char tmp[1024];
-    int len = fread(tmp, sizeof(char), sizeof(tmp), fp);
-    if (len == 0) {
-      break;
+// Read the file into a buffer which ends with a newline followed by a null character.
+// This is used if the file cannot be mapped to memory.
+static char *read_contents(int fd, size_t size) {
+  char *buf = calloc(size + 2, sizeof(char));
+  for (size_t len = 0; len < size;) {
+    ssize_t n = pread(fd, buf + len, size - len, len);
+    if (n <= 0) {
+      free(buf);
+      return NULL;
     }
-    fwrite(tmp, sizeof(char), len, buffp);
+    len += n;
+  }
+
+  if (buf[size - 1] != '\n') {
+    buf[size] = '\n';
+  }
+  return buf;
+}
+
+// Map the file to memory instead of copying it.
+// The contents must end with a newline followed by a null character.
+// Bytes behind the end of file up to the page boundary are zero-filled,
+// and an anonymous page is reserved behind the file if there is not enough room,
+// so the terminator is provided without copying the file.
+// If the file cannot be mapped, it is read into a buffer instead.
+static char *map_file(int fd, size_t size) {
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t map_size = (size + 2 + page - 1) / page * page;
+
+  char *buf = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buf == MAP_FAILED) {
+    return read_contents(fd, size);
+  }
+
+  if (mmap(buf, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(buf, map_size);
+    return read_contents(fd, size);
   }
-  fclose(fp);
-  fflush(buffp);
 
   // To make processing easier, insert '\n' if there is not '\n' at the end.
-  if (buflen == 0 || buf[buflen - 1] != '\n') {
-    fputc('\n', buffp);
+  // Only the last page of the file is copied by the kernel in this case.
+  if (buf[size - 1] != '\n') {
+    char *last_page = buf + size / page * page;
+    if (mprotect(last_page, page, PROT_READ | PROT_WRITE) != 0) {
+      munmap(buf, map_size);
+      return read_contents(fd, size);
+    }
+    buf[size] = '\n';
+  }
+
+  return buf;
+}
+
+// Open the file and return it.
+// If the path cannot be opened as a regular file, return NULL.
+File *open_file(char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return NULL;
+  }
+
+  char *contents = "\n";
+  if (st.st_size != 0 && (contents = map_file(fd, st.st_size)) == NULL) {
+    close(fd);
+    return NULL;
   }
-  fputc('\0', buffp);
-  fclose(buffp);
+  close(fd);
 
-  return new_file(path, buf);
+  File *file = new_file(path, contents);
+  file->mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+  return file;
+}
+
+File *read_file(char *path) {
+  File *file = open_file(path);
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open the file: %s\n", path);
+    exit(1);
+  }
+  return file;
 }
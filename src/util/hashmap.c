@@ -1,4 +1,9 @@
 // This is an implementatin of the open addressing HashTable.
+//
+// It is laid out like a Swiss table. Each bucket has a control byte,
+// which is empty, deleted, or the top 7 bits of the hash of the key.
+// The control bytes of a group of 16 buckets are compared at once,
+// and the keys are compared only when the control byte matches.
 
 #include "util/util.h"
 
@@ -7,17 +12,29 @@
 #include <stdlib.h>
 #include <string.h>
 
-// Bucket size of initialize (include update operation)
-#define INIT_SIZE 128
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
 
-// When the usage reaches 75%, we need to update the HashMap to a larger size.
-#define MAX_USAGE 75
+// Bucket size of initialize
+// It must be a power of two, and a multiple of the group size.
+#define INIT_SIZE 16
+
+// Number of buckets whose control bytes are compared at once
+#define GROUP_SIZE 16
+
+// When the usage reaches 87%, we need to update the HashMap.
+#define MAX_USAGE 87
 
 // When update a HashMap, keep the usage below 50%.
 #define LOW_USAGE 50
 
-// Replace delete item
-#define TOMBSTONE ((void *)-1)
+// Control bytes
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xfe)
+
+// Key length of the pointer keys
+#define PTR_KEYLEN -1
 
 static uint64_t fnv1hash(char *str, int len) {
   uint64_t hash = 14695981039346656037u;
@@ -29,88 +46,196 @@ static uint64_t fnv1hash(char *str, int len) {
   return hash;
 }
 
-static void hashmap_update(HashMap *map) {
-  int capacity = map->capacity;
-  while ((map->used - map->tombstone) * 100 / capacity >= LOW_USAGE) {
-    capacity += INIT_SIZE;
-  }
-
-  HashMap new_map = {};
-  new_map.buckets = calloc(capacity, sizeof(HashBucket));
-  new_map.capacity = capacity;
+// The top bits of the hash are stored in the control byte,
+// and the low bits select the group.
+static uint8_t hash_ctrl(uint64_t hash) {
+  return hash >> 57;
+}
 
-  for (int i = 0; i < map->capacity; i++) {
-    HashBucket *bucket = &(map->buckets[i]);
+// Return the bit mask of the control bytes in the group equal to ctrl.
+static unsigned match_group(uint8_t *group, uint8_t ctrl) {
+#if defined(__x86_64__)
+  __m128i v = _mm_loadu_si128((__m128i *)group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(ctrl)));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < GROUP_SIZE; i++) {
+    mask |= (unsigned)(group[i] == ctrl) << i;
+  }
+  return mask;
+#endif
+}
 
-    if (bucket->key != NULL && bucket->key != TOMBSTONE) {
-      hashmap_ninsert(&new_map, bucket->key, bucket->keylen, bucket->item);
-    }
+// Return the bit mask of the empty or deleted buckets in the group.
+// Their control bytes have the top bit, but the full buckets do not.
+static unsigned match_free(uint8_t *group) {
+#if defined(__x86_64__)
+  return _mm_movemask_epi8(_mm_loadu_si128((__m128i *)group));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < GROUP_SIZE; i++) {
+    mask |= (unsigned)(group[i] >> 7) << i;
   }
+  return mask;
+#endif
+}
 
-  free(map->buckets);
-  *map = new_map;
+// Groups are probed by triangular numbers,
+// which visit all groups since the number of groups is a power of two.
+static int probe_group(uint64_t hash, int probe, int group_mask) {
+  return (hash + (uint64_t)probe * (probe + 1) / 2) & group_mask;
 }
 
-void hashmap_insert(HashMap *map, char *key, void *item) {
-  hashmap_ninsert(map, key, strlen(key), item);
+// The hash is compared first, so that the keys are compared only if the hashes match.
+// Keys from the same Atom are the same pointer, and they are not compared either.
+// Pointer keys have the length PTR_KEYLEN, and they match only the same pointer.
+static bool match_bucket(HashBucket *bucket, char *key, int keylen, uint64_t hash) {
+  return bucket->hash == hash && bucket->keylen == keylen &&
+         (bucket->key == key || (keylen != PTR_KEYLEN && memcmp(bucket->key, key, keylen) == 0));
 }
 
-void hashmap_ninsert(HashMap *map, char *key, int keylen, void *item) {
+static HashBucket *hashmap_get_bucket(HashMap *map, char *key, int keylen, uint64_t hash) {
   if (map->buckets == NULL) {
-    map->buckets = calloc(INIT_SIZE, sizeof(HashBucket));
-    map->capacity = INIT_SIZE;
-  } else if ((map->used - map->tombstone) * 100 / map->capacity >= MAX_USAGE) {
-    hashmap_update(map);
+    return NULL;
   }
 
-  uint64_t hash = fnv1hash(key, keylen);
+  int group_mask = map->capacity / GROUP_SIZE - 1;
+  uint8_t ctrl = hash_ctrl(hash);
 
-  for (int i = 0; i < map->capacity; i++) {
-    HashBucket *bucket = &(map->buckets[(hash + i) % map->capacity]);
-
-    if (bucket->key == NULL) {
-      bucket->key = key;
-      bucket->keylen = keylen;
-      bucket->item = item;
-      map->used++;
-      return;
+  for (int probe = 0; probe <= group_mask; probe++) {
+    int idx = probe_group(hash, probe, group_mask) * GROUP_SIZE;
+    uint8_t *group = &(map->ctrl[idx]);
+
+    for (unsigned mask = match_group(group, ctrl); mask != 0; mask &= mask - 1) {
+      HashBucket *bucket = &(map->buckets[idx + __builtin_ctz(mask)]);
+      if (match_bucket(bucket, key, keylen, hash)) {
+        return bucket;
+      }
     }
 
-    if (bucket->key == TOMBSTONE) {
-      bucket->key = key;
-      bucket->keylen = keylen;
-      bucket->item = item;
-      map->tombstone--;
-      return;
+    // The key is not in the HashMap if the probe has reached an empty bucket.
+    if (match_group(group, CTRL_EMPTY) != 0) {
+      return NULL;
     }
+  }
 
-    if (strncmp(bucket->key, key, keylen) == 0 && bucket->keylen == keylen) {
-      bucket->item = item;
-      return;
+  return NULL;
+}
+
+// Return the index of the first empty or deleted bucket to insert the key.
+static int find_free_bucket(HashMap *map, uint64_t hash) {
+  int group_mask = map->capacity / GROUP_SIZE - 1;
+
+  for (int probe = 0; probe <= group_mask; probe++) {
+    int idx = probe_group(hash, probe, group_mask) * GROUP_SIZE;
+    unsigned mask = match_free(&(map->ctrl[idx]));
+    if (mask != 0) {
+      return idx + __builtin_ctz(mask);
     }
   }
+
+  // Unreachable, since the usage is kept below MAX_USAGE.
+  fprintf(stderr, "HashMap is full\n");
+  exit(1);
 }
 
-static HashBucket *hashmap_get_bucket(HashMap *map, char *key, int keylen) {
-  uint64_t hash = fnv1hash(key, keylen);
+static void hashmap_init(HashMap *map, int capacity) {
+  map->buckets = calloc(capacity, sizeof(HashBucket));
+  map->ctrl = malloc(capacity);
+  memset(map->ctrl, CTRL_EMPTY, capacity);
+  map->capacity = capacity;
+  map->used = 0;
+  map->tombstone = 0;
+}
 
-  for (int i = 0; i < map->capacity; i++) {
-    HashBucket *bucket = &(map->buckets[(hash + i) % map->capacity]);
+// Rebuild the HashMap without deleted buckets.
+// The capacity is doubled until the usage is below LOW_USAGE.
+static void hashmap_update(HashMap *map) {
+  int live = map->used - map->tombstone;
+  int capacity = map->capacity;
+  while ((int64_t)(live + 1) * 100 >= (int64_t)capacity * LOW_USAGE) {
+    capacity *= 2;
+  }
 
-    if (bucket->key == NULL) {
-      return NULL;
-    }
+  HashMap new_map = {};
+  hashmap_init(&new_map, capacity);
 
-    if (bucket->key == TOMBSTONE) {
+  // The keys are known to be unique, so they are not compared.
+  for (int i = 0; i < map->capacity; i++) {
+    if (map->ctrl[i] & CTRL_EMPTY) {
       continue;
     }
 
-    if (strncmp(bucket->key, key, keylen) == 0 && bucket->keylen == keylen) {
-      return bucket;
-    }
+    HashBucket *bucket = &(map->buckets[i]);
+    int idx = find_free_bucket(&new_map, bucket->hash);
+    new_map.ctrl[idx] = map->ctrl[i];
+    new_map.buckets[idx] = *bucket;
+    new_map.used++;
   }
 
-  return NULL;
+  free(map->buckets);
+  free(map->ctrl);
+  *map = new_map;
+}
+
+static void hashmap_insert_hashed(HashMap *map, char *key, int keylen, uint64_t hash, void *item) {
+  HashBucket *bucket = hashmap_get_bucket(map, key, keylen, hash);
+  if (bucket != NULL) {
+    bucket->item = item;
+    return;
+  }
+
+  if (map->buckets == NULL) {
+    hashmap_init(map, INIT_SIZE);
+  } else if ((int64_t)(map->used + 1) * 100 >= (int64_t)map->capacity * MAX_USAGE) {
+    hashmap_update(map);
+  }
+
+  int idx = find_free_bucket(map, hash);
+  if (map->ctrl[idx] == CTRL_DELETED) {
+    map->tombstone--;
+  } else {
+    map->used++;
+  }
+
+  map->ctrl[idx] = hash_ctrl(hash);
+  bucket = &(map->buckets[idx]);
+  bucket->key = key;
+  bucket->keylen = keylen;
+  bucket->hash = hash;
+  bucket->item = item;
+}
+
+static void hashmap_delete_bucket(HashMap *map, HashBucket *bucket) {
+  int idx = bucket - map->buckets;
+  uint8_t *group = &(map->ctrl[idx & ~(GROUP_SIZE - 1)]);
+
+  // If the group has an empty bucket, every probe stops at this group,
+  // so the bucket can be empty instead of deleted.
+  if (match_group(group, CTRL_EMPTY) != 0) {
+    map->ctrl[idx] = CTRL_EMPTY;
+    map->used--;
+  } else {
+    map->ctrl[idx] = CTRL_DELETED;
+    map->tombstone++;
+  }
+}
+
+void hashmap_insert(HashMap *map, char *key, void *item) {
+  hashmap_ninsert(map, key, strlen(key), item);
+}
+
+void hashmap_ninsert(HashMap *map, char *key, int keylen, void *item) {
+  hashmap_insert_hashed(map, key, keylen, fnv1hash(key, keylen), item);
+}
+
+void hashmap_ainsert(HashMap *map, Atom *atom, void *item) {
+  hashmap_insert_hashed(map, atom->name, atom->len, atom->hash, item);
+}
+
+// The pointer itself is the key, and the object it points to is not read.
+void hashmap_pinsert(HashMap *map, void *ptr, void *item) {
+  hashmap_insert_hashed(map, ptr, PTR_KEYLEN, fnv1hash((char *)&ptr, sizeof(ptr)), item);
 }
 
 void *hashmap_get(HashMap *map, char *key) {
@@ -118,7 +243,25 @@ void *hashmap_get(HashMap *map, char *key) {
 }
 
 void *hashmap_nget(HashMap *map, char *key, int keylen) {
-  HashBucket *bucket = hashmap_get_bucket(map, key, keylen);
+  HashBucket *bucket = hashmap_get_bucket(map, key, keylen, fnv1hash(key, keylen));
+
+  if (bucket != NULL) {
+    return bucket->item;
+  }
+  return NULL;
+}
+
+void *hashmap_aget(HashMap *map, Atom *atom) {
+  HashBucket *bucket = hashmap_get_bucket(map, atom->name, atom->len, atom->hash);
+
+  if (bucket != NULL) {
+    return bucket->item;
+  }
+  return NULL;
+}
+
+void *hashmap_pget(HashMap *map, void *ptr) {
+  HashBucket *bucket = hashmap_get_bucket(map, ptr, PTR_KEYLEN, fnv1hash((char *)&ptr, sizeof(ptr)));
 
   if (bucket != NULL) {
     return bucket->item;
@@ -131,10 +274,46 @@ void hashmap_delete(HashMap *map, char *key) {
 }
 
 void hashmap_ndelete(HashMap *map, char *key, int keylen) {
-  HashBucket *bucket = hashmap_get_bucket(map, key, keylen);
+  HashBucket *bucket = hashmap_get_bucket(map, key, keylen, fnv1hash(key, keylen));
 
   if (bucket != NULL) {
-    bucket->key = TOMBSTONE;
-    map->tombstone++;
+    hashmap_delete_bucket(map, bucket);
+  }
+}
+
+void hashmap_adelete(HashMap *map, Atom *atom) {
+  HashBucket *bucket = hashmap_get_bucket(map, atom->name, atom->len, atom->hash);
+
+  if (bucket != NULL) {
+    hashmap_delete_bucket(map, bucket);
   }
 }
+
+void hashmap_foreach(HashMap *map, hashmap_foreach_fn *fn) {
+  for (int i = 0; i < map->capacity; i++) {
+    if (!(map->ctrl[i] & CTRL_EMPTY)) {
+      HashBucket *bucket = &(map->buckets[i]);
+      fn(bucket->key, bucket->keylen, bucket->item);
+    }
+  }
+}
+
+// All atoms are interned in this table.
+static HashMap atoms;
+
+// Return the unique Atom of the name.
+// The name is copied when it is interned for the first time.
+Atom *intern_atom(char *name, int len) {
+  uint64_t hash = fnv1hash(name, len);
+  HashBucket *bucket = hashmap_get_bucket(&atoms, name, len, hash);
+  if (bucket != NULL) {
+    return bucket->item;
+  }
+
+  Atom *atom = calloc(1, sizeof(Atom));
+  atom->name = strndup(name, len);
+  atom->len = len;
+  atom->hash = hash;
+  hashmap_ainsert(&atoms, atom, atom);
+  return atom;
+}
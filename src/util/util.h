@@ -3,12 +3,12 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include <stdbool.h>
+#include <stdint.h>
 
 //
 // util.c
 //
 
-char *erase_bslash_str(char *ptr, int len);
 bool isident(char c);
 
 //
@@ -17,11 +17,30 @@ bool isident(char c);
 
 typedef struct {
   char *name;
-  char *contents;
+  char *contents;  // Contents after line splicing
+
+  // Line splicing removes backslash-newline from the original contents.
+  // The removed locations are kept to refer to the original contents
+  // in diagnostics.
+  char *orig_contents;
+  int splice_cnt;
+  int *splice_offset;  // Offset in contents where the line splicing occurred
+  int *splice_shift;   // Total length removed up to the line splicing
+
+  int64_t mtime;  // Last modification time in nanoseconds
+
+  // Offset of the beginning of each line in the original contents.
+  // It is built when a line number is needed for the first time.
+  int line_cnt;
+  int *line_offset;
 } File;
 
 File *new_file(char *name, char *contents);
+File *open_file(char *path);
 File *read_file(char *path);
+char *get_orig_loc(File *file, char *loc);
+int get_line_no(File *file, char *orig_loc);
+char *get_line_begin(File *file, int line_no);
 
 //
 // hashmap.c
@@ -32,22 +51,70 @@ File *read_file(char *path);
 typedef struct {
   char *key;
   int keylen;
+  uint64_t hash;
   void *item;
 } HashBucket;
 
 typedef struct {
   HashBucket *buckets;
-  int used;
+  uint8_t *ctrl;  // Control bytes of the buckets
+  int used;       // Number of full or deleted buckets
   int tombstone;
   int capacity;
 } HashMap;
 
+// Interned name with its hash.
+// There is only one Atom for each name, so they can be compared by pointer,
+// and the HashMap does not need to hash them again.
+typedef struct {
+  char *name;
+  int len;
+  uint64_t hash;
+} Atom;
+
+Atom *intern_atom(char *name, int len);
+
 void hashmap_insert(HashMap *map, char *key, void *item);
 void hashmap_ninsert(HashMap *map, char *key, int keylen, void *item);
 void *hashmap_get(HashMap *map, char *key);
 void *hashmap_nget(HashMap *map, char *key, int keylen);
 void hashmap_delete(HashMap *map, char *key);
 void hashmap_ndelete(HashMap *map, char *key, int keylen);
+void hashmap_ainsert(HashMap *map, Atom *atom, void *item);
+void *hashmap_aget(HashMap *map, Atom *atom);
+void hashmap_adelete(HashMap *map, Atom *atom);
+void hashmap_pinsert(HashMap *map, void *ptr, void *item);
+void *hashmap_pget(HashMap *map, void *ptr);
+
+typedef void hashmap_foreach_fn(char *key, int keylen, void *item);
+void hashmap_foreach(HashMap *map, hashmap_foreach_fn *fn);
+
+//
+// arena.c
+//
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+  char *name;
+  ArenaBlock *blocks;
+  char *ptr;  // Next free memory in the current block
+  char *end;  // End of the current block
+
+  // Statistics printed by "--stats" option
+  int64_t allocs;
+  int64_t bytes;
+  int64_t reserved;
+} Arena;
+
+extern Arena token_arena;   // Tokens, literals and hidesets
+extern Arena ast_arena;     // Nodes, objects and initializers
+extern Arena type_arena;    // Types and members
+extern Arena string_arena;  // Labels and strings made by the compiler
+
+void *arena_calloc(Arena *arena, int64_t cnt, int64_t size);
+char *arena_strndup(Arena *arena, char *str, int len);
+void print_arena_stats();
 
 //
 // error.c
@@ -23,6 +23,18 @@ NE__);
 
   CHECK(3, THREE);
 
+  CHECK(4, ({
+    i\
+nt a = 4;
+    a;
+  }));
+
+  CHECK(99, ({
+    char str[] = "ab\
+cde";
+    str[2];
+  }));
+
   return 0;
 }
 
@@ -0,0 +1,53 @@
+#include <float.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "test.h"
+
+struct S {
+  char a;
+  int b;
+  long c;
+};
+
+int main() {
+  CHECK(8, sizeof(size_t));
+  CHECK(8, sizeof(ptrdiff_t));
+  CHECK(1, NULL == (void *)0);
+  CHECK(4, offsetof(struct S, b));
+  CHECK(8, offsetof(struct S, c));
+  CHECK(24, sizeof(va_list));
+
+  CHECK(1, ({
+    bool a = true;
+    a == 1 && !false;
+  }));
+
+  CHECK(15, sizeof(int8_t) + sizeof(int16_t) + sizeof(int32_t) + sizeof(int64_t));
+  CHECK(8, sizeof(uintptr_t));
+  CHECK(-128, INT8_MIN);
+  CHECK(255, UINT8_MAX);
+  CHECKL(9223372036854775807L, INT64_MAX);
+  CHECKL(-9223372036854775807L - 1, INT64_MIN);
+  CHECKUL(18446744073709551615UL, SIZE_MAX);
+  CHECKL(5, INT64_C(5));
+
+  CHECK(8, CHAR_BIT);
+  CHECK(-32768, SHRT_MIN);
+  CHECK(2147483647, INT_MAX);
+  CHECK(1, INT_MIN < 0);
+  CHECKUL(4294967295, UINT_MAX);
+  CHECKL(9223372036854775807L, LONG_MAX);
+
+  CHECK(53, DBL_MANT_DIG);
+  CHECK(1, FLT_EPSILON > 0 && FLT_EPSILON < 0.001);
+  CHECK(1, 1.0 + DBL_EPSILON > 1.0);
+  CHECK(1, 1.0 + DBL_EPSILON / 2 == 1.0);
+  CHECK(1, DBL_MIN > 0);
+  CHECKD(1e-5, 0.00001);
+
+  return 0;
+}
@@ -0,0 +1,3 @@
+// A local header whose name is the same as a builtin header.
+// It is included by include5_jcc.c instead of the builtin one.
+int local_float_h = 7;
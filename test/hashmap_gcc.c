@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 char *genkey(int i) {
   char *str = calloc(30, sizeof(char));
@@ -59,6 +60,48 @@ int main() {
   }
 
   assert(hashmap_get(map, "hello") == NULL);
+
+  // Atoms and strings find the same items.
+  for (int i = 1024; i < 2048; i++) {
+    char *key = genkey(i);
+    Atom *atom = intern_atom(key, strlen(key));
+    assert(atom == intern_atom(genkey(i), strlen(key)));
+    assert(*((int*)hashmap_aget(map, atom)) == i);
+    hashmap_adelete(map, atom);
+    assert(hashmap_get(map, key) == NULL);
+    hashmap_ainsert(map, atom, genval(-i));
+    assert(*((int*)hashmap_get(map, key)) == -i);
+  }
+  assert(hashmap_aget(map, intern_atom("hello", 5)) == NULL);
+
+  // The deleted buckets are reused by the following insertions.
+  // The map is filled enough that some groups have no empty bucket,
+  // so the deletions leave tombstones.
+  HashMap *full = calloc(1, sizeof(HashMap));
+  int cnt = 0;
+  do {
+    hashmap_insert(full, genkey(cnt), genval(cnt));
+    cnt++;
+  } while (full->capacity < 4096 || (full->used + 1) * 100 < full->capacity * 85);
+
+  int capacity = full->capacity;
+  for (int i = 0; i < cnt; i += 2) {
+    hashmap_delete(full, genkey(i));
+  }
+  int tombstone = full->tombstone;
+  assert(tombstone > 0);
+  assert(full->used - full->tombstone == cnt / 2);
+
+  for (int i = 0; i < cnt; i += 2) {
+    hashmap_insert(full, genkey(i), genval(i));
+  }
+  assert(full->capacity == capacity);
+  assert(full->tombstone < tombstone);
+  assert(full->used - full->tombstone == cnt);
+  for (int i = 0; i < cnt; i++) {
+    assert(*((int*)hashmap_get(full, genkey(i))) == i);
+  }
+
   printf("Hashmap check passed.\n");
 
   return 0;
@@ -0,0 +1,40 @@
+#include "include3_jcc.h"
+#include "include4_jcc.h"
+#include "include3_jcc.h"
+#include "include4_jcc.h"
+
+#define EMPTY
+
+#if 0
+This group isn't tokenized, so @ and ` may appear here.
+#if 1
+int chain = 5;
+#endif
+#endif
+
+#ifdef EMPTY // Comment after the directive
+int commented = 6;
+#else
+int commented = 7;
+#endif
+
+#if 0
+int chain = 1;
+#elif 1
+#if 0
+int chain = 2;
+#else
+int chain = 3;
+#endif
+#else
+int chain = 4;
+#endif
+
+int main() {
+  CHECK(3, guarded);
+  CHECK(5, once);
+  CHECK(3, chain EMPTY);
+  CHECK(6, commented);
+
+  return 0;
+}
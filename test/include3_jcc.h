@@ -0,0 +1,12 @@
+#ifndef INCLUDE3_JCC_H
+#define INCLUDE3_JCC_H
+
+#include "test.h"
+
+#ifdef INCLUDE3_JCC_H
+int guarded = 3;
+#else
+int guarded = 4;
+#endif
+
+#endif
@@ -0,0 +1,10 @@
+#include "test.h"
+#include "float.h"
+#include <limits.h>
+
+int main() {
+  check(7, local_float_h, "local_float_h");
+  check(127, CHAR_MAX, "CHAR_MAX");
+
+  return 0;
+}
@@ -367,5 +367,47 @@ int main() {
     a;
   }));
 
+#define PAREN (1) + 2
+  #  define INDENTED 4
+
+  CHECK(3, PAREN);
+  CHECK(4, INDENTED);
+  CHECK(3, MAX (3, 2));
+  CHECKSTR("a + b", str(  a   +
+      b  ));
+
+  // Examples of the C standard, where hidesets prevent recursive expansion.
+#define xstr_va(...) str_va(__VA_ARGS__)
+#define str_va(...) #__VA_ARGS__
+#define x 3
+#define f(a) f(x * (a))
+#undef x
+#define x 2
+#define g f
+#define z z[0]
+#define t(a) a
+#define p() int
+#define q(x) x
+#define r(x,y) x ## y
+  CHECKSTR("f(2 * (y+1)) + f(2 * (f(2 * (z[0])))) % f(2 * (0)) + t(1);",
+           xstr_va(f(y+1) + f(f(z)) % t(t(g)(0) + t)(1);));
+  CHECKSTR("int i[] = { 1, 23, 4, 5, };", xstr_va(p() i[q()] = { q(1), r(2,3), r(4,), r(,5), r(,) };));
+#undef x
+#undef f
+#undef g
+#undef z
+#undef t
+#undef p
+#undef q
+#undef r
+
+#define CAT3(a, b, c) a ## b ## c
+#define SELF SELF + 1
+#define LOOP1 LOOP2
+#define LOOP2 LOOP1
+#define BRACKET(a, b) [a ## b]
+  CHECKSTR("123 b SELF + 1 LOOP1 LOOP2 [] [2]", xstr(CAT3(1, 2, 3) CAT3(, b, ) SELF LOOP1 LOOP2 BRACKET(,) BRACKET(2,)));
+  CHECKSTR("\"a\\\"b\" '\\'' \"\\\\\"", str("a\"b" '\'' "\\"));
+
   return 0;
 }
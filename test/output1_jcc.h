@@ -0,0 +1 @@
+- // Included twice in a row by output_jcc.c without an include guard.
@@ -0,0 +1,46 @@
+#include "test.h"
+
+// The tokens of the macro expansions must be read as the same tokens
+// when the output of "-E" option is compiled again.
+#define EMPTY
+#define NEG -
+#define PLUS +
+#define DIV /
+#define DOT .
+#define NUM 1
+#define ELLIPSIS ...
+#define CALL(f, x) f(x)
+
+int sum(int cnt, ELLIPSIS);
+struct A { int x; };
+
+int sum(int cnt, ...) {
+  return cnt;
+}
+
+// The lines of a header included again are not joined with the previous lines.
+int twice1 = 5
+#include "output1_jcc.h"
+#include "output1_jcc.h"
+  3;
+int twice2 = 5
+#include "output2_jcc.h"
+#include "output2_jcc.h"
+  3;
+
+int main() {
+  int a = 3, b = 2, *p = &b;
+  struct A s = {5};
+
+  CHECK(3, -NEG a);
+  CHECK(5, NEG-a + b);
+  CHECK(5, a PLUS+b);
+  CHECK(1, a DIV*p);
+  CHECK(5, s DOT x);
+  CHECK(2, CALL(sum, 2));
+  CHECK(11, NUM+10);
+  EMPTY CHECK(3, a);
+  CHECK(8, twice1);
+  CHECK(8, twice2);
+  return 0;
+}
@@ -0,0 +1,16 @@
+#include "pch_jcc.h"
+#include "include4_jcc.h"
+
+int main() {
+  CHECK(7, pch_global);
+  CHECK(7, PCH_VALUE);
+  CHECK(11, PCH_ADD(5, 6));
+  char str[] = PCH_STR(ab);
+  CHECK(98, str[1]);
+  CHECK(104, pch_str[4]);
+  CHECKD(1.5, pch_double);
+  CHECK(31, pch_func(2));
+  CHECK(5, once);
+
+  return 0;
+}
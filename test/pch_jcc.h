@@ -0,0 +1,20 @@
+#ifndef PCH_JCC_H
+#define PCH_JCC_H
+
+#include "test.h"
+#include "include4_jcc.h"
+
+#define PCH_VALUE 7
+#define PCH_ADD(a, b) ((a) + (b))
+#define PCH_STR(x) #x
+
+int pch_global = PCH_ADD(3, 4);
+char pch_str[] = "pch\
+ header";
+double pch_double = 1.5;
+
+int pch_func(int x) {
+  return x * PCH_VALUE + __LINE__;
+}
+
+#endif
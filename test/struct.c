@@ -28,6 +28,11 @@ struct E {
 
 struct E ea = {2, 50, 1, -1, 240};
 
+struct FWD;
+const struct FWD *fwdp;
+struct FWD { int a; };
+struct FWD fwd = {7};
+
 struct F {
   int a: 2;
   int b: 10;
@@ -417,5 +422,10 @@ int main() {
     bar.a + bar.deep->a;
   }));
 
+  CHECK(7, ({
+    fwdp = &fwd;
+    fwdp->a;
+  }));
+
   return 0;
 }
@@ -13,7 +13,7 @@ check() {
 }
 
 compile() {
-  gcc -E -P -C $1 > $1.tmp
+  ../jcc -E -P $1 $1.tmp
   ../jcc $1.tmp $1.s
   gcc -static -g -o tmp $2 common.o $1.s
   rm $1.s $1.tmp
@@ -42,16 +42,87 @@ check function_abi_jcc.c
 compile_only_jcc macro_jcc
 check macro_jcc.c
 
+# Check preprocessed output with linemarkers
+../jcc -E macro_jcc.c macro_jcc.i
+gcc -static -g -o tmp common.o macro_jcc.i
+rm macro_jcc.i
+check "macro_jcc.c (-E)"
+
+# Check that the expanded tokens are read as the same tokens again
+../jcc -E output_jcc.c output_jcc.i
+gcc -static -g -o tmp common.o output_jcc.i
+rm output_jcc.i
+check output_jcc.c
+../jcc -E -P output_jcc.c output_jcc.i
+gcc -static -g -o tmp common.o output_jcc.i
+rm output_jcc.i
+check output_jcc.c
+
 # Check include
 compile_only_jcc include1_jcc
 check include1_jcc.c
 
 compile_only_jcc include2_jcc
 check include2_jcc.c
+
+compile_only_jcc include3_jcc
+check include3_jcc.c
+
+compile_only_jcc include5_jcc
+check include5_jcc.c
  
 compile_only_jcc bslash_jcc
 check bslash_jcc.c
 
+# Check dependency output
+../jcc -MM include2_jcc.c include2_jcc.d
+if grep -q "^include2_jcc.o: include2_jcc.c" include2_jcc.d && grep -q "^  include1_jcc.h" include2_jcc.d; then
+  echo "test dependency passed."
+  rm include2_jcc.d
+else
+  echo "test dependency failed."
+  exit 1
+fi
+
+# Check dependency output of "-E -MD" to stdout
+../jcc -E -MD include2_jcc.c > /dev/null
+if [ $? -eq 0 ] && grep -q "^include2_jcc.o: include2_jcc.c" include2_jcc.d; then
+  echo "test dependency with -E passed."
+  rm include2_jcc.d
+else
+  echo "test dependency with -E failed."
+  exit 1
+fi
+
+# Check precompiled header
+../jcc --emit-pch pch_jcc.h pch_jcc.pch
+../jcc -include-pch pch_jcc.pch pch_jcc.c pch_jcc.s
+gcc -static -g -o tmp common.o pch_jcc.s
+rm pch_jcc.s
+check pch_jcc.c
+
+# Check that a broken precompiled header is rejected
+head -c 200 pch_jcc.pch > pch_jcc.pch.tmp
+../jcc -include-pch pch_jcc.pch.tmp pch_jcc.c pch_jcc.s 2> pch_jcc.err
+if [ $? -eq 1 ] && grep -q "is broken" pch_jcc.err; then
+  echo "test broken pch passed."
+  rm pch_jcc.pch pch_jcc.pch.tmp pch_jcc.err
+else
+  echo "test broken pch failed."
+  exit 1
+fi
+
+# Check that pasting into a comment is rejected
+printf '#define CAT(a, b) a ## b\nCAT(/, /)\n' > paste_jcc.tmp.c
+../jcc -E paste_jcc.tmp.c 2> paste_jcc.err > /dev/null
+if [ $? -eq 1 ] && grep -q "pasting does not give a valid preprocessing token" paste_jcc.err; then
+  echo "test invalid paste passed."
+  rm paste_jcc.tmp.c paste_jcc.err
+else
+  echo "test invalid paste failed."
+  exit 1
+fi
+
 for src_file in `\find . -name '*.c' -not -name '*jcc.c' -not -name '*gcc.c' -not -name 'function_abi.c'`; do
   compile $src_file
   check $src_file
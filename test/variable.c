@@ -283,6 +283,11 @@ int main() {
     s[6];
   }));
 
+  CHECK(131, ({
+    char s[] = "long string literal /* longer than 32 bytes */\t\"with\" escapes\\";
+    s[47] + s[52] + sizeof(s) - s[62];
+  }));
+
   CHECK(107, ({
     char s[][6] = {"12345", "67890"};
     s[0][1] + s[1][3];
@@ -401,5 +406,41 @@ int main() {
     a[2] + a[5] + a[1];
   }));
 
+  CHECK(321, ({
+    int a = 1, ans = 0;
+    {
+      int a = 2;
+      {
+        int a = 3;
+        ans += a * 100;
+      }
+      ans += a * 10;
+    }
+    ans + a;
+  }));
+
+  CHECK(45, ({
+    struct T { int x; } t = {1};
+    typedef int U;
+    {
+      struct T { int x, y; } t = {2, 3};
+      typedef char U;
+    }
+    t.x + sizeof(struct T) * 10 + sizeof(U);
+  }));
+
+  CHECK(60, ({
+    typedef int *P;
+    int x = 2, y = 5;
+    int *const a = &x;
+    const P b = &y;
+    P c = &x;
+    int *d = &y;
+    c = d;
+    d = a;
+    int e[4], f[4][4];
+    *c * 10 + *d + sizeof(e) + sizeof(f[1]) - 24;
+  }));
+
   return 0;
 }